@@ -0,0 +1,520 @@
+/**
+ * @file   po_bench.c
+ * @author Tero Isannainen <tero.isannainen@gmail.com>
+ * @date   Sun Jan  8 15:32:51 2023
+ *
+ * @brief  Postor - Benchmarks.
+ *
+ * Benchmarks for Postor operations over container sizes. Each result
+ * is reported as one JSON object per line (JSON Lines):
+ *
+ *     {"op":"push","n":1024,"ops":1024,"reps":5,"ns_per_op":1.52,
+ *      "ns_per_op_median":1.60,"ops_per_sec":657894736,
+ *      "peak_rss_kb":1880}
+ *
+ * "ns_per_op" is the best of repetitions, and "ns_per_op_median" is
+ * median (mean of middle pair for even "reps"). Each line is measured
+ * in its own (forked) process, hence "peak_rss_kb" is the peak
+ * resident size for that operation and size. First line describes
+ * the run. Random data uses fixed seed, hence runs are reproducible.
+ *
+ * Usage:
+ *
+ *     po_bench [-m <max-n>] [-r <reps>] [-o <op>]
+ *
+ *     -m  Maximum container size (default: 1000000).
+ *     -r  Repetitions per measurement (default: 5).
+ *     -o  Run only operations whose name contains <op>.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "postor.h"
+
+
+/** Item visits per measurement for O(n) operations. */
+#define PO_BENCH_BUDGET ( 1ULL << 26 )
+
+/** Maximum operation count per measurement for O(n) operations. */
+#define PO_BENCH_MAX_OPS 100000ULL
+
+/** Maximum repetitions. */
+#define PO_BENCH_MAX_REPS 64
+
+
+/** Benchmark function, returns operation count. */
+typedef po_size_t ( *po_bench_fn_p )( po_size_t n );
+
+/** Benchmark. */
+typedef struct
+{
+    const char*   name; /**< Operation name. */
+    po_bench_fn_p fn;   /**< Benchmark function. */
+} po_bench_s;
+
+
+/** Random state. */
+static uint64_t po_bench_seed;
+
+/** Timer start (set by po_bench_start()). */
+static struct timespec po_bench_t0;
+
+/** Measured time in ns (set by po_bench_stop()). */
+static double po_bench_ns;
+
+/** Sink for results, prevents optimizing operations away. */
+volatile uintptr_t po_bench_sink;
+
+
+
+/* ------------------------------------------------------------
+ * Support:
+ */
+
+
+/** Return next pseudo random number (xorshift64). */
+static uint64_t po_bench_rand( void )
+{
+    po_bench_seed ^= po_bench_seed << 13;
+    po_bench_seed ^= po_bench_seed >> 7;
+    po_bench_seed ^= po_bench_seed << 17;
+    return po_bench_seed;
+}
+
+
+/** Start timer. */
+static void po_bench_start( void )
+{
+    clock_gettime( CLOCK_MONOTONIC, &po_bench_t0 );
+}
+
+
+/** Stop timer. */
+static void po_bench_stop( void )
+{
+    struct timespec t1;
+
+    clock_gettime( CLOCK_MONOTONIC, &t1 );
+    po_bench_ns = ( t1.tv_sec - po_bench_t0.tv_sec ) * 1e9 + ( t1.tv_nsec - po_bench_t0.tv_nsec );
+}
+
+
+/** Return operation count for O(n) operation. */
+static po_size_t po_bench_linear_ops( po_size_t n )
+{
+    po_size_t ops = PO_BENCH_BUDGET / n;
+
+    if ( ops == 0 ) {
+        ops = 1;
+    } else if ( ops > PO_BENCH_MAX_OPS ) {
+        ops = PO_BENCH_MAX_OPS;
+    }
+
+    return ops;
+}
+
+
+/** Fill Postor with "n" items (1...n). */
+static po_t po_bench_fill( po_t po, po_size_t n )
+{
+    po_new_sized( po, n );
+    for ( po_size_t i = 0; i < n; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+
+    return po;
+}
+
+
+/** Compare items as pointers (for sort). */
+static int po_bench_compare( const po_d a, const po_d b )
+{
+    uintptr_t x = *(uintptr_t*)a;
+    uintptr_t y = *(uintptr_t*)b;
+
+    return ( x > y ) - ( x < y );
+}
+
+
+/** Compare item with reference (for find_with). */
+static int po_bench_equal( const po_d a, const po_d b )
+{
+    return a == b;
+}
+
+
+/** Return peak RSS of the process in kB. */
+static long po_bench_peak_rss( void )
+{
+    struct rusage ru;
+
+    getrusage( RUSAGE_SELF, &ru );
+    return ru.ru_maxrss;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Benchmarks:
+ */
+
+
+/** Push "n" items to empty Postor (includes growth). */
+static po_size_t po_bench_push( po_size_t n )
+{
+    po_s ps;
+
+    po_new( &ps );
+    po_bench_start();
+    for ( po_size_t i = 0; i < n; i++ ) {
+        po_push( &ps, (po_d)( i + 1 ) );
+    }
+    po_bench_stop();
+    po_destroy_storage( &ps );
+
+    return n;
+}
+
+
+/** Pop "n" items. */
+static po_size_t po_bench_pop( po_size_t n )
+{
+    po_s      ps;
+    uintptr_t sum = 0;
+
+    po_bench_fill( &ps, n );
+    po_bench_start();
+    for ( po_size_t i = 0; i < n; i++ ) {
+        sum += (uintptr_t)po_pop( &ps );
+    }
+    po_bench_stop();
+    po_bench_sink = sum;
+    po_destroy_storage( &ps );
+
+    return n;
+}
+
+
+/** Grow Postor to "n" with explicit resizes (doubling). */
+static po_size_t po_bench_resize( po_size_t n )
+{
+    po_s      ps;
+    po_size_t ops = 0;
+
+    po_new( &ps );
+    po_bench_start();
+    for ( po_size_t size = PO_DEFAULT_SIZE * 2; size <= 2 * n; size *= 2 ) {
+        po_resize( &ps, size );
+        ops++;
+    }
+    po_bench_stop();
+    po_destroy_storage( &ps );
+
+    return ops ? ops : 1;
+}
+
+
+/**
+ * Insert and delete at position (fraction of usage).
+ *
+ * @param n    Usage.
+ * @param frac Position as fraction (0: front, 1: end).
+ *
+ * @return Operation count.
+ */
+static po_size_t po_bench_insert_delete( po_size_t n, double frac )
+{
+    po_s      ps;
+    po_size_t ops = po_bench_linear_ops( n );
+    po_pos_t  pos = (po_pos_t)( frac * n );
+
+    po_bench_fill( &ps, n );
+    po_bench_start();
+    for ( po_size_t i = 0; i < ops; i++ ) {
+        po_insert_at( &ps, pos, (po_d)1 );
+        po_delete_at( &ps, pos );
+    }
+    po_bench_stop();
+    po_destroy_storage( &ps );
+
+    /* Insert and delete are counted separately. */
+    return 2 * ops;
+}
+
+
+static po_size_t po_bench_insdel_front( po_size_t n )
+{
+    return po_bench_insert_delete( n, 0.0 );
+}
+
+
+static po_size_t po_bench_insdel_middle( po_size_t n )
+{
+    return po_bench_insert_delete( n, 0.5 );
+}
+
+
+static po_size_t po_bench_insdel_end( po_size_t n )
+{
+    return po_bench_insert_delete( n, 1.0 );
+}
+
+
+/** Find random items with po_find(). */
+static po_size_t po_bench_find( po_size_t n )
+{
+    po_s      ps;
+    po_size_t ops = po_bench_linear_ops( n );
+    uintptr_t sum = 0;
+
+    po_bench_fill( &ps, n );
+    po_bench_start();
+    for ( po_size_t i = 0; i < ops; i++ ) {
+        sum += po_find( &ps, (po_d)( po_bench_rand() % n + 1 ) );
+    }
+    po_bench_stop();
+    po_bench_sink = sum;
+    po_destroy_storage( &ps );
+
+    return ops;
+}
+
+
+/** Find random items with po_find_with(). */
+static po_size_t po_bench_find_with( po_size_t n )
+{
+    po_s      ps;
+    po_size_t ops = po_bench_linear_ops( n );
+    uintptr_t sum = 0;
+
+    po_bench_fill( &ps, n );
+    po_bench_start();
+    for ( po_size_t i = 0; i < ops; i++ ) {
+        sum += po_find_with( &ps, po_bench_equal, (po_d)( po_bench_rand() % n + 1 ) );
+    }
+    po_bench_stop();
+    po_bench_sink = sum;
+    po_destroy_storage( &ps );
+
+    return ops;
+}
+
+
+/** Sort "n" random items (ns per item). */
+static po_size_t po_bench_sort( po_size_t n )
+{
+    po_s ps;
+
+    po_new_sized( &ps, n );
+    for ( po_size_t i = 0; i < n; i++ ) {
+        po_push( &ps, (po_d)po_bench_rand() );
+    }
+    po_bench_start();
+    po_sort( &ps, po_bench_compare );
+    po_bench_stop();
+    po_destroy_storage( &ps );
+
+    return n;
+}
+
+
+/** Allocate "n" 24 byte objects from arena. */
+static po_size_t po_bench_alloc_bytes( po_size_t n )
+{
+    po_s      ps;
+    uintptr_t sum = 0;
+
+    po_new_arena( &ps, 16 );
+    po_bench_start();
+    for ( po_size_t i = 0; i < n; i++ ) {
+        sum += (uintptr_t)po_alloc_bytes( &ps, 24 );
+    }
+    po_bench_stop();
+    po_bench_sink = sum;
+    po_destroy_storage( &ps );
+
+    return n;
+}
+
+
+/** Visit items summing pointees (shuffled objects) with po_visit(). */
+static void po_bench_visit_fn( po_d item, po_d state )
+{
+    *(uint64_t*)state += *(uint64_t*)item;
+}
+
+
+/** Visit "n" items pointing to shuffled objects. */
+static po_size_t po_bench_visit( po_size_t n )
+{
+    po_s      ps;
+    uint64_t* objs = malloc( n * sizeof( uint64_t ) );
+    uint64_t  sum = 0;
+
+    po_new_sized( &ps, n );
+    for ( po_size_t i = 0; i < n; i++ ) {
+        objs[ i ] = i;
+        po_push( &ps, &objs[ i ] );
+    }
+    for ( po_size_t i = n - 1; i > 0; i-- ) {
+        po_size_t j = po_bench_rand() % ( i + 1 );
+        po_d      tmp = ps.data[ i ];
+        ps.data[ i ] = ps.data[ j ];
+        ps.data[ j ] = tmp;
+    }
+    po_bench_start();
+    po_visit( &ps, po_bench_visit_fn, &sum );
+    po_bench_stop();
+    po_bench_sink = sum;
+    po_destroy_storage( &ps );
+    free( objs );
+
+    return n;
+}
+
+
+/** All benchmarks. */
+static const po_bench_s po_bench_list[] = {
+    { "push", po_bench_push },
+    { "pop", po_bench_pop },
+    { "resize", po_bench_resize },
+    { "insdel_front", po_bench_insdel_front },
+    { "insdel_middle", po_bench_insdel_middle },
+    { "insdel_end", po_bench_insdel_end },
+    { "find", po_bench_find },
+    { "find_with", po_bench_find_with },
+    { "sort", po_bench_sort },
+    { "alloc_bytes", po_bench_alloc_bytes },
+    { "visit", po_bench_visit },
+};
+
+
+/** Sizes (up to max). */
+static const po_size_t po_bench_sizes[] = {
+    16, 256, 4096, 65536, 1000000, 16000000, 100000000
+};
+
+
+/** Compare doubles (for median). */
+static int po_bench_cmp_double( const void* a, const void* b )
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return ( x > y ) - ( x < y );
+}
+
+
+/**
+ * Measure benchmark for size and report result.
+ *
+ * @param bench Benchmark.
+ * @param n     Size.
+ * @param reps  Repetitions.
+ */
+static void po_bench_measure( const po_bench_s* bench, po_size_t n, int reps )
+{
+    double    ns[ PO_BENCH_MAX_REPS ];
+    double    median;
+    po_size_t ops = 0;
+
+    po_bench_seed = 0x9E3779B97F4A7C15ULL;
+
+    for ( int r = 0; r < reps; r++ ) {
+        ops = bench->fn( n );
+        ns[ r ] = po_bench_ns / ops;
+    }
+
+    qsort( ns, reps, sizeof( double ), po_bench_cmp_double );
+    median = ( reps % 2 ) ? ns[ reps / 2 ] : ( ns[ reps / 2 - 1 ] + ns[ reps / 2 ] ) / 2;
+
+    printf( "{\"op\":\"%s\",\"n\":%lu,\"ops\":%lu,\"reps\":%d,"
+            "\"ns_per_op\":%.3f,\"ns_per_op_median\":%.3f,"
+            "\"ops_per_sec\":%.0f,\"peak_rss_kb\":%ld}\n",
+            bench->name,
+            (unsigned long)n,
+            (unsigned long)ops,
+            reps,
+            ns[ 0 ],
+            median,
+            ns[ 0 ] > 0 ? 1e9 / ns[ 0 ] : 0.0,
+            po_bench_peak_rss() );
+    fflush( stdout );
+}
+
+
+/**
+ * Run benchmark for size in child process, so that peak RSS is not
+ * inherited from earlier runs.
+ *
+ * @param bench Benchmark.
+ * @param n     Size.
+ * @param reps  Repetitions.
+ */
+static void po_bench_run( const po_bench_s* bench, po_size_t n, int reps )
+{
+    pid_t pid;
+
+    fflush( stdout );
+    pid = fork();
+    if ( pid == 0 ) {
+        po_bench_measure( bench, n, reps );
+        _exit( 0 );
+    } else if ( pid > 0 ) {
+        waitpid( pid, NULL, 0 );
+    } else {
+        po_bench_measure( bench, n, reps );
+    }
+}
+
+
+int main( int argc, char** argv )
+{
+    po_size_t   max = 1000000;
+    int         reps = 5;
+    const char* only = NULL;
+
+    for ( int i = 1; i < argc; i++ ) {
+        if ( !strcmp( argv[ i ], "-m" ) && i + 1 < argc ) {
+            max = strtoull( argv[ ++i ], NULL, 0 );
+        } else if ( !strcmp( argv[ i ], "-r" ) && i + 1 < argc ) {
+            reps = atoi( argv[ ++i ] );
+        } else if ( !strcmp( argv[ i ], "-o" ) && i + 1 < argc ) {
+            only = argv[ ++i ];
+        } else {
+            fprintf( stderr, "Usage: po_bench [-m <max-n>] [-r <reps>] [-o <op>]\n" );
+            return 1;
+        }
+    }
+
+    if ( reps < 1 ) {
+        reps = 1;
+    } else if ( reps > PO_BENCH_MAX_REPS ) {
+        reps = PO_BENCH_MAX_REPS;
+    }
+
+    printf( "{\"postor_version\":\"%s\",\"max_n\":%lu,\"reps\":%d}\n",
+            POSTOR_VERSION,
+            (unsigned long)max,
+            reps );
+
+    for ( size_t b = 0; b < sizeof( po_bench_list ) / sizeof( po_bench_list[ 0 ] ); b++ ) {
+        if ( only && !strstr( po_bench_list[ b ].name, only ) ) {
+            continue;
+        }
+        for ( size_t s = 0; s < sizeof( po_bench_sizes ) / sizeof( po_bench_sizes[ 0 ] ); s++ ) {
+            if ( po_bench_sizes[ s ] <= max ) {
+                po_bench_run( &po_bench_list[ b ], po_bench_sizes[ s ], reps );
+            }
+        }
+    }
+
+    return 0;
+}
@@ -8,11 +8,32 @@
  */
 
 #define _POSIX_C_SOURCE 200112L
+#ifdef __linux__
+/* For mremap(). */
+#define _GNU_SOURCE
+#endif
 
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include "postor.h"
+#include "postor_sort.h"
+
+#if defined( __linux__ ) && !defined( POSTOR_NO_MMAP )
+#include <sys/mman.h>
+/** @cond postor_none */
+#define PO_USE_MMAP 1
+/** @endcond postor_none */
+#endif
+
+#if defined( __GNUC__ ) && defined( __x86_64__ ) && !defined( POSTOR_NO_SIMD )
+#include <immintrin.h>
+/** @cond postor_none */
+#define PO_USE_SIMD 1
+/** @endcond postor_none */
+#endif
 
 
 /* clang-format off */
@@ -39,6 +60,36 @@
 #define pm_first( po )     ( po )->data[ 0 ]
 #define pm_nth( po, pos )  ( po )->data[ ( pos ) ]
 
+#define pm_indexed( po )   ( ( po )->ext && ( po )->ext->index )
+#define pm_head( po )      ( ( po )->ext ? ( po )->ext->head : 0 )
+#define pm_mapped( po )    ( ( po )->ext && ( po )->ext->mapped )
+#define pm_shrink( po )    ( ( po )->ext && ( po )->ext->shrink )
+#define pm_shared( po )    ( ( po )->ext && ( po )->ext->shared )
+#define pm_own( po )                            \
+    do {                                        \
+        if ( pm_shared( po ) ) {                \
+            po_unshare( po );                   \
+        }                                       \
+    } while ( 0 )
+
+#ifndef POSTOR_NO_CLEAR
+#define pm_clear( po )     ( !( ( po )->ext && ( po )->ext->noclear ) )
+#else
+#define pm_clear( po )     ( (void)( po ), 0 )
+#endif
+#define pm_alloc( po, n )  ( pm_clear( po ) ? po_malloc( n ) : po_malloc_raw( n ) )
+
+#ifdef POSTOR_USE_STATS
+#define pm_stat_add( field, n ) __atomic_fetch_add( &po_stats.field, ( n ), __ATOMIC_RELAXED )
+#define pm_stat_max( field, n ) po_stats_max( &po_stats.field, ( n ) )
+#else
+#define pm_stat_add( field, n ) ( (void)0 )
+#define pm_stat_max( field, n ) ( (void)0 )
+#endif
+
+#define pm_seg_chunk( sg, k ) ( (po_d*)pm_nth( &( sg )->dir, ( k ) ) )
+#define pm_seg_mask( sg )     ( ( 1ULL << ( sg )->shift ) - 1 )
+
 #define pm_unit2byte(n)    ((n)<<3)
 #define pm_byte2unit(n)    ((n)>>3)
 
@@ -47,15 +98,243 @@
 /* clang-format on */
 
 
+/** @cond postor_none */
+
+/* Sort with compare function, i.e. qsort style compare. */
+#define po_sort_cb_less( compare, a, b ) ( compare( &( a ), &( b ) ) < 0 )
+po_sort_define( po_sort_cb, po_compare_fn_p, po_sort_cb_less )
+
+/** @endcond postor_none */
+
+
+/** Key and item pair for po_sort_by_key(). */
+typedef struct
+{
+    uint64_t key;
+    po_d     item;
+} po_keyed_s;
+
+
+/** Parallel sort task, i.e. chunk sort or (part of) run merge. */
+typedef struct
+{
+    po_d*           src;     /**< Source buffer. */
+    po_d*           dst;     /**< Destination buffer. */
+    po_size_t       a;       /**< Start of first run. */
+    po_size_t       m;       /**< Start of second run. */
+    po_size_t       e;       /**< End of second run. */
+    po_size_t       k0;      /**< Merge output start (relative to "a"). */
+    po_size_t       k1;      /**< Merge output end (relative to "a"). */
+    po_compare_fn_p compare; /**< Compare function. */
+} po_sort_task_s;
+
+
+/** Parallel find task. */
+typedef struct
+{
+    po_t            po;      /**< Postor. */
+    po_compare_fn_p compare; /**< Compare function. */
+    po_d            ref;     /**< Item to find. */
+    po_size_t       beg;     /**< Chunk start. */
+    po_size_t       end;     /**< Chunk end. */
+    po_size_t*      best;    /**< Lowest match so far (shared). */
+} po_find_task_s;
+
+
+/**
+ * Hash index, i.e. open addressing (linear probing) table mapping
+ * items to positions.
+ */
+typedef struct
+{
+    po_hash_fn_p    hash;  /**< Hash function (NULL for identity). */
+    po_compare_fn_p equal; /**< Equal function (NULL for identity). */
+    po_size_t       mask;   /**< Slot count - 1 (power of 2). */
+    po_size_t       origin; /**< Slot value of position 0. */
+    po_size_t*      slots;  /**< Position + origin (0 for empty slot). */
+} po_index_s;
+
+
+/** Retired arena block. */
+typedef struct
+{
+    po_d*     data; /**< Block storage. */
+    po_size_t size; /**< Block size. */
+    po_size_t used; /**< Block usage when retired. */
+} po_arena_block_s;
+
+
+/**
+ * Postor extension.
+ *
+ * Extension is allocated on demand, i.e. default Postor has NULL
+ * extension.
+ */
+struct po_ext_s
+{
+    po_growth_t       growth;     /**< Growth policy. */
+    po_size_t         step;       /**< Step for PO_GROW_STEP. */
+    po_grow_fn_p      resize;     /**< Resize function for PO_GROW_FN. */
+    po_d              state;      /**< Resize function state. */
+    po_index_s*       index;      /**< Hash index (or NULL). */
+    po_size_t         head;       /**< Free slots before data (po_pop_front). */
+    po_size_t         total;      /**< Allocation size, when head > 0. */
+    int               arena;      /**< Growable arena (po_new_arena). */
+    int               noclear;    /**< Skip clearing of new storage. */
+    int               shrink;     /**< Automatic shrinking (po_set_shrink). */
+    int               map;        /**< Mapping flags (PO_MAP_*). */
+    po_size_t         mapped;     /**< Mapped range in bytes (0 for heap storage). */
+    po_arena_block_s* blocks;     /**< Arena: retired blocks (or NULL). */
+    po_size_t         block_used; /**< Arena: retired block count. */
+    po_size_t         block_size; /**< Arena: retired block capacity. */
+    po_size_t*        shared;     /**< Reference count of shared storage (or NULL). */
+};
+
+
+#ifdef POSTOR_USE_STATS
+/** Global statistics. */
+static po_stats_s po_stats;
+#endif
+
+
+#ifdef POSTOR_USE_POOL
+
+/** Pool list index for descriptor slab entries. */
+#define PO_POOL_SLAB ( PO_POOL_SHIFT + 1 )
+
+/** Slab size in bytes (power of two, slabs are aligned to it). */
+#define PO_SLAB_BYTES \
+    ( (size_t)1 << ( 64 - __builtin_clzll( PO_SLAB_COUNT * sizeof( po_s ) - 1 ) ) )
+
+/** Free block. */
+typedef struct po_pool_node_s
+{
+    struct po_pool_node_s* next; /**< Next free block. */
+} po_pool_node_s;
+
+/** List of free blocks per size class. */
+typedef struct
+{
+    po_pool_node_s* head[ PO_POOL_SHIFT + 2 ];  /**< Free blocks. */
+    po_size_t       count[ PO_POOL_SHIFT + 2 ]; /**< Free block count. */
+} po_pool_list_s;
+
+/**
+ * Slab registry, open addressing set of slab base addresses.
+ *
+ * Registry is only grown, and replaced sets are kept, so that
+ * descriptor ownership can be checked without lock.
+ */
+typedef struct po_slab_set_s
+{
+    struct po_slab_set_s* prev;   /**< Replaced set (or NULL). */
+    size_t                mask;   /**< Slot count - 1. */
+    size_t                count;  /**< Registered slab count. */
+    uintptr_t             slot[]; /**< Slab bases (0 for empty). */
+} po_slab_set_s;
+
+/** Thread cache. */
+static __thread po_pool_list_s po_pool_cache;
+
+/** Thread cache is registered for thread exit. */
+static __thread int po_pool_registered;
+
+/** Global depot. */
+static po_pool_list_s po_pool_depot;
+
+/** Depot lock. */
+static pthread_mutex_t po_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Slab registry (updated under depot lock). */
+static po_slab_set_s* po_slab_set;
+
+/** Key for thread exit. */
+static pthread_key_t po_pool_key;
+
+/** Key creation. */
+static pthread_once_t po_pool_once = PTHREAD_ONCE_INIT;
+
+#endif
+
+
+/**
+ * Item search kernels (scalar or vectorized).
+ *
+ * Kernel returns "n" when item is not found.
+ */
+typedef struct
+{
+    po_size_t ( *find )( const po_d* data, po_size_t n, po_d item );
+    po_size_t ( *find_last )( const po_d* data, po_size_t n, po_d item );
+    po_size_t ( *count )( const po_d* data, po_size_t n, po_d item );
+} po_find_kernel_s;
+
+
 static po_t po_allocate_descriptor_if( po_t po );
+#ifdef POSTOR_USE_STATS
+static void po_stats_max( po_size_t* field, po_size_t value );
+#endif
+static void po_free_descriptor( po_t po );
+static po_x po_ext( po_t po );
+static void po_ext_copy( po_t to, po_t from );
+static void po_ext_destroy( po_t po );
+static void po_ext_reset( po_t po );
+static int po_ext_custom( po_t po );
+static void po_share_release( po_t po, po_d* base );
+static int po_index_build( po_t po, po_size_t slots );
+static po_size_t po_index_lookup( po_t po, po_d item );
+static void po_index_add( po_t po, po_size_t pos );
+static void po_index_del( po_t po, po_size_t pos );
+static void po_index_move( po_t po, po_size_t from, po_size_t to );
+static void po_index_shift( po_t po, po_size_t pos, int delta );
+static void po_index_offset( po_t po, int delta );
+static po_size_t po_index_slot_of( po_index_s* index, po_d item, po_size_t pos );
+static void po_index_sync( po_t po );
+static void po_index_clear( po_t po );
+static po_d* po_cc_segment( po_cc_t cc, po_size_t k );
+static void po_rebase( po_t po );
+static int po_make_headroom( po_t po );
+static int po_tail_full( po_t po );
+static void po_set_head( po_t po, po_size_t head );
+static int po_arena_grow( po_t po, po_size_t units );
+static po_d* po_store_resize( po_t po, po_d* base, po_size_t old_size, po_size_t new_size );
+static void po_store_free( po_t po, po_d* base );
+static po_d* po_store_alloc( po_t po, po_size_t size );
+#ifdef POSTOR_USE_POOL
+static po_d* po_pool_alloc( po_size_t size );
+static void po_pool_free( po_d* base, po_size_t size );
+static po_pool_list_s* po_pool_thread( void );
+static void po_pool_release( po_pool_list_s* list, int c, po_size_t keep );
+static po_t po_slab_alloc( void );
+static void po_slab_free( po_t po );
+static po_s* po_slab_create( void );
+static void po_slab_insert( po_slab_set_s* set, uintptr_t base );
+static int po_slab_owns( po_t po );
+#endif
+#ifdef PO_USE_MMAP
+static po_size_t po_map_granule( po_t po, po_size_t bytes );
+static po_d* po_map_create( po_t po, po_size_t bytes );
+#endif
 static void po_set_size( po_t po, po_size_t size );
 static void po_set_size_and_local( po_t po, po_size_t size, int local );
 static void po_init( po_t po, po_size_t size, po_d data, int local );
 static po_size_t po_align_size( po_size_t new_size );
-static po_size_t po_incr_size( po_t po );
+static po_size_t po_incr_size( po_t po, po_size_t need );
 static po_size_t po_legal_size( po_size_t size );
 static po_size_t po_norm_idx( po_t po, po_pos_t idx );
 static void po_resize_to( po_t po, po_size_t new_size );
+static void po_reserve_for( po_t po, po_size_t new_used );
+static inline void po_prefetch( po_d* data, po_size_t idx, po_size_t end );
+static int po_shrinkable( po_t po );
+static void po_shrink_auto( po_t po );
+static po_size_t po_compact( po_t po, po_pred_fn_p pred, po_d state, int keep );
+static const po_find_kernel_s* po_find_kernel( void );
+static po_size_t po_bound( po_t po, po_compare_fn_p compare, po_d ref, int upper );
+static po_size_t po_thread_count( po_size_t threads, po_size_t n );
+static void po_run_tasks( void* ( *fn )( void* ), void* tasks, size_t task_size, po_size_t count );
+static void* po_sort_task( void* arg );
+static void* po_merge_task( void* arg );
+static void* po_find_task( void* arg );
 void po_void_assert( void );
 
 
@@ -79,7 +358,8 @@ po_t po_new_sized( po_t po, po_size_t size )
     }
 
     size = po_legal_size( size );
-    po_init( po, size, po_malloc( pm_unit2byte( size ) ), 0 );
+    po_init( po, size, NULL, 0 );
+    po->data = po_store_alloc( po, size );
 
     return po;
 }
@@ -105,6 +385,77 @@ po_t po_new_pages( po_t po, po_size_t count )
 }
 
 
+po_t po_new_arena( po_t po, po_size_t count )
+{
+    po = po_new_pages( po, count );
+    if ( po == NULL ) {
+        return po;
+    }
+
+    if ( po_ext( po ) ) {
+        po->ext->arena = po_true;
+    }
+
+    return po;
+}
+
+
+po_t po_new_mapped( po_t po, po_size_t size, po_size_t reserve, int flags )
+{
+#ifdef PO_USE_MMAP
+    po_d* data;
+    po_x  ext;
+
+    po = po_new_descriptor( po );
+    if ( po == NULL || po_ext( po ) == NULL ) {
+        return po;
+    }
+
+    size = po_legal_size( size );
+    if ( reserve < size ) {
+        reserve = size;
+    }
+
+    ext = po->ext;
+    ext->map = flags;
+    data = po_map_create( po, pm_unit2byte( reserve ) );
+    if ( data == NULL ) {
+        po_ext_destroy( po ); // GCOV_EXCL_LINE
+        return po;            // GCOV_EXCL_LINE
+    }
+
+    po_init( po, size, data, 0 );
+    po->ext = ext;
+
+    return po;
+#else
+    (void)reserve;
+    (void)flags;
+    return po_new_sized( po, size );
+#endif
+}
+
+
+po_t po_new_packed( po_size_t size )
+{
+    po_t  po;
+    po_d* data;
+
+    size = po_legal_size( size );
+
+    po = po_malloc( sizeof( po_s ) + pm_unit2byte( size ) );
+    if ( po == NULL ) {
+        return NULL;
+    }
+    data = (po_d*)( po + 1 );
+
+    /* Data is "local", since it is freed with descriptor. */
+    po_init( po, size, data, 1 );
+
+    return po;
+}
+
+
 po_t po_new_descriptor( po_t po )
 {
     po = po_allocate_descriptor_if( po );
@@ -114,6 +465,7 @@ po_t po_new_descriptor( po_t po )
     po->size = 0;
     po->used = 0;
     po->data = NULL;
+    po->ext = NULL;
 
     return po;
 }
@@ -127,7 +479,10 @@ po_t po_use( po_t po, po_d* mem, po_size_t size )
     po_assert( size >= PO_MIN_SIZE );
 
     po_init( po, size, mem, 1 );
-    memset( po->data, 0, pm_unit2byte( size ) );
+    if ( pm_clear( po ) ) {
+        memset( po->data, 0, pm_unit2byte( size ) );
+        pm_stat_add( clear_bytes, pm_unit2byte( size ) );
+    }
 
     return po;
 }
@@ -136,8 +491,8 @@ po_t po_use( po_t po, po_d* mem, po_size_t size )
 po_t po_destroy( po_t po )
 {
     if ( po ) {
-        po_destroy_storage( po );
-        po_free( po );
+        po_release( po );
+        po_free_descriptor( po );
     }
     
     return NULL;
@@ -150,17 +505,40 @@ void po_destroy_storage( po_t po )
         return;
     }
 
-    if ( po->data && !po_local( po ) ) {
-        po_free( po->data );
+    if ( pm_shared( po ) ) {
+        po_share_release( po, po->data - pm_head( po ) );
+    } else if ( po->data && !po_local( po ) ) {
+        po_store_free( po, po->data - pm_head( po ) );
     }
     
     po->data = NULL;
     po_set_size( po, 0 );
+
+    /* Extension is kept only for user settings. */
+    po_ext_reset( po );
+    if ( !po_ext_custom( po ) ) {
+        po_ext_destroy( po );
+    }
+}
+
+
+void po_release( po_t po )
+{
+    if ( po == NULL ) {
+        return;
+    }
+
+    po_destroy_storage( po );
+    po_ext_destroy( po );
 }
 
 
 void po_resize( po_t po, po_size_t new_size )
 {
+    if ( po->ext && po->ext->growth == PO_GROW_FN ) {
+        new_size = po->ext->resize( po, new_size, po->ext->state );
+    }
+
     new_size = po_legal_size( new_size );
 
     if ( new_size >= po->used ) {
@@ -169,27 +547,259 @@ void po_resize( po_t po, po_size_t new_size )
 }
 
 
+int po_set_growth( po_t po, po_growth_t growth, po_size_t step )
+{
+    po_x ext;
+
+    /* PO_GROW_FN requires resize function (po_set_resize_fn()). */
+    if ( growth == PO_GROW_FN && ( po->ext == NULL || po->ext->resize == NULL ) ) {
+        return po_false;
+    }
+
+    ext = po_ext( po );
+    if ( ext == NULL ) {
+        return po_false;
+    }
+
+    ext->growth = growth;
+    ext->step = step;
+
+    return po_true;
+}
+
+
+int po_set_resize_fn( po_t po, po_grow_fn_p resize, po_d state )
+{
+    po_x ext;
+
+    if ( resize == NULL ) {
+        return po_false;
+    }
+
+    ext = po_ext( po );
+    if ( ext == NULL ) {
+        return po_false;
+    }
+
+    ext->growth = PO_GROW_FN;
+    ext->resize = resize;
+    ext->state = state;
+
+    return po_true;
+}
+
+
+po_growth_t po_get_growth( po_t po )
+{
+    if ( po->ext ) {
+        return po->ext->growth;
+    } else {
+        return PO_GROW_DOUBLE;
+    }
+}
+
+
+int po_set_clear( po_t po, int clear )
+{
+    po_x ext;
+
+    ext = po_ext( po );
+    if ( ext == NULL ) {
+        return po_false;
+    }
+
+    ext->noclear = !clear;
+
+    return po_true;
+}
+
+
+int po_set_shrink( po_t po, int shrink )
+{
+    po_x ext;
+
+    ext = po_ext( po );
+    if ( ext == NULL ) {
+        return po_false;
+    }
+
+    ext->shrink = shrink;
+
+    return po_true;
+}
+
+
+void po_shrink_to_fit( po_t po )
+{
+    po_size_t size;
+
+    if ( !po_shrinkable( po ) ) {
+        return;
+    }
+
+    size = po_legal_size( po->used );
+    if ( size < pm_size( po ) || pm_head( po ) > 0 ) {
+        po_resize_to( po, size );
+    }
+}
+
+
 void po_push( po_t po, po_d item )
 {
     po_size_t new_used = po->used + 1;
 
+    pm_own( po );
+
     if ( new_used > pm_size( po ) ) {
-        po_resize_to( po, po_incr_size( po ) );
+        po_resize_to( po, po_incr_size( po, new_used ) );
     }
 
     pm_nth( po, po->used ) = item;
     po->used = new_used;
+    pm_stat_max( peak_used, new_used );
+
+    if ( pm_indexed( po ) ) {
+        po_index_add( po, new_used - 1 );
+    }
+}
+
+
+void po_push_n( po_t po, const po_d* items, po_size_t count )
+{
+    uintptr_t off;
+    int       own;
+
+    pm_own( po );
+
+    if ( count == 0 ) {
+        return;
+    }
+
+    /* Items within own storage are relocated, if storage moves. */
+    off = (uintptr_t)items - (uintptr_t)po->data;
+    own = ( po->data && (uintptr_t)items >= (uintptr_t)po->data
+            && off < pm_unit2byte( po->used ) );
+
+    po_reserve_for( po, po->used + count );
+    if ( own ) {
+        items = (const po_d*)( (char*)po->data + off );
+    }
+    memmove( &( pm_end( po ) ), items, count * po_unit_size );
+    po->used += count;
+    po_index_sync( po );
+}
+
+
+void po_append_postor( po_t po, po_t other )
+{
+    pm_own( po );
+
+    /* Count is fixed first, since "other" may be "po". */
+    po_size_t count = other->used;
+
+    if ( count == 0 ) {
+        return;
+    }
+
+    po_reserve_for( po, po->used + count );
+    memcpy( &( pm_end( po ) ), other->data, count * po_unit_size );
+    po->used += count;
+    po_index_sync( po );
+}
+
+
+void po_push_front( po_t po, po_d item )
+{
+    pm_own( po );
+
+    /* Local Postor gets headroom only if it already has extension. */
+    if ( ( po->ext == NULL && po_local( po ) ) || po_ext( po ) == NULL ) {
+        po_insert_at( po, 0, item );
+        return;
+    }
+
+    if ( ( po->ext->head == 0 || po_tail_full( po ) ) && !po_make_headroom( po ) ) {
+        po_insert_at( po, 0, item );
+        return;
+    }
+
+    po->data--;
+    po_set_head( po, po->ext->head - 1 );
+    pm_first( po ) = item;
+    po->used++;
+    pm_stat_max( peak_used, po->used );
+    if ( pm_indexed( po ) ) {
+        po_index_offset( po, 1 );
+        po_index_add( po, 0 );
+    }
+}
+
+
+po_d po_pop_front( po_t po )
+{
+    po_d ret;
+
+    pm_own( po );
+
+    if ( pm_empty( po ) ) {
+        return NULL;
+    }
+
+    /* Pop never allocates storage: move items, if local Postor has
+     * no extension or size after headroom would drop below usage. */
+    if ( ( po->ext == NULL && po_local( po ) ) || po_ext( po ) == NULL
+         || ( po->used > 1 && po_tail_full( po ) ) ) {
+        ret = pm_first( po );
+        po_delete_at( po, 0 );
+        return ret;
+    }
+
+    if ( pm_indexed( po ) ) {
+        po_index_del( po, 0 );
+    }
+
+    ret = pm_first( po );
+    po->used--;
+
+    if ( pm_empty( po ) ) {
+        /* Restart from allocation start. */
+        po_rebase( po );
+        pm_first( po ) = NULL;
+    } else {
+        if ( po->ext->head == 0 ) {
+            po->ext->total = pm_size( po );
+        }
+        po->data++;
+        po_set_head( po, po->ext->head + 1 );
+    }
+
+    if ( pm_indexed( po ) ) {
+        po_index_offset( po, -1 );
+    }
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
+    }
+
+    return ret;
 }
 
 
 po_d po_pop( po_t po )
 {
+    pm_own( po );
+
     if ( pm_any( po ) ) {
         po_d ret = pm_last( po );
+        if ( pm_indexed( po ) ) {
+            po_index_del( po, po->used - 1 );
+        }
         po->used--;
         if ( pm_empty( po ) ) {
             pm_first( po ) = NULL;
         }
+        if ( pm_shrink( po ) ) {
+            po_shrink_auto( po );
+        }
         return ret;
     } else {
         return NULL;
@@ -199,11 +809,22 @@ po_d po_pop( po_t po )
 
 po_size_t po_drop( po_t po, po_size_t count )
 {
-    if ( po->used >= count ) {
+    if ( count >= po->used ) {
+        count = po->used;
+        po->used = 0;
+        po_index_clear( po );
+    } else if ( pm_indexed( po ) && count <= po->used - count ) {
+        /* Fewer dropped than remaining: delete entries one by one. */
+        for ( po_size_t i = po->used - count; i < po->used; i++ ) {
+            po_index_del( po, i );
+        }
         po->used -= count;
     } else {
-        count = po->used;
-        po_reset( po );
+        po->used -= count;
+        po_index_sync( po );
+    }
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
     }
 
     return count;
@@ -213,7 +834,10 @@ po_size_t po_drop( po_t po, po_size_t count )
 void po_add( po_t po, po_d item )
 {
     if ( po->data == NULL ) {
+        /* Preserve settings of empty descriptor. */
+        po_x ext = po->ext;
         po_new( po );
+        po->ext = ext;
     }
     po_push( po, item );
 }
@@ -238,13 +862,40 @@ po_d po_remove( po_t po )
 void po_reset( po_t po )
 {
     po->used = 0;
+    po_index_clear( po );
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
+    }
 }
 
 
 void po_clear( po_t po )
 {
+    pm_own( po );
+
     po->used = 0;
     memset( po->data, 0, po_byte_size( po ) );
+    pm_stat_add( clear_bytes, po_byte_size( po ) );
+    po_index_clear( po );
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
+    }
+}
+
+
+void po_clear_used( po_t po )
+{
+    pm_own( po );
+
+    if ( po->data ) {
+        memset( po->data, 0, po_used_size( po ) );
+        pm_stat_add( clear_bytes, po_used_size( po ) );
+    }
+    po->used = 0;
+    po_index_sync( po );
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
+    }
 }
 
 
@@ -255,13 +906,71 @@ po_s po_duplicate( po_t po )
     po_new_sized( &dup, pm_size( po ) );
     dup.used = po->used;
     memcpy( dup.data, po->data, po_used_size( po ) );
+    po_ext_copy( &dup, po );
 
     return dup;
 }
 
 
-po_d po_swap( po_t po, po_pos_t pos, po_d item )
+po_s po_duplicate_shared( po_t po )
 {
+    po_s       dup;
+    po_size_t* shared;
+
+    if ( po->data == NULL || po_local( po ) || pm_head( po ) || pm_mapped( po )
+         || ( po->ext && po->ext->arena ) || po_ext( po ) == NULL ) {
+        return po_duplicate( po );
+    }
+
+    shared = po->ext->shared;
+    if ( shared == NULL ) {
+        shared = po_malloc( sizeof( po_size_t ) );
+        if ( shared == NULL ) {
+            return po_duplicate( po ); // GCOV_EXCL_LINE
+        }
+        *shared = 1;
+        po->ext->shared = shared;
+    }
+
+    po_new_descriptor( &dup );
+    dup.data = po->data;
+    dup.used = po->used;
+    po_set_size( &dup, pm_size( po ) );
+    po_ext_copy( &dup, po );
+    if ( dup.ext == NULL ) {
+        return po_duplicate( po ); // GCOV_EXCL_LINE
+    }
+
+    __atomic_add_fetch( shared, 1, __ATOMIC_RELAXED );
+    dup.ext->shared = shared;
+
+    return dup;
+}
+
+
+void po_unshare( po_t po )
+{
+    if ( pm_shared( po ) ) {
+        if ( __atomic_load_n( po->ext->shared, __ATOMIC_ACQUIRE ) == 1 ) {
+            /* Last holder owns the storage. */
+            po_share_release( po, NULL );
+        } else {
+            po_resize_to( po, pm_size( po ) );
+        }
+    }
+}
+
+
+int po_is_shared( po_t po )
+{
+    return pm_shared( po );
+}
+
+
+po_d po_swap( po_t po, po_pos_t pos, po_d item )
+{
+    pm_own( po );
+
     if ( po->data == NULL ) {
         return NULL;
     }
@@ -275,7 +984,13 @@ po_d po_swap( po_t po, po_pos_t pos, po_d item )
 
     norm = po_norm_idx( po, pos );
     ret = pm_nth( po, norm );
-    pm_nth( po, norm ) = item;
+    if ( pm_indexed( po ) ) {
+        po_index_del( po, norm );
+        pm_nth( po, norm ) = item;
+        po_index_add( po, norm );
+    } else {
+        pm_nth( po, norm ) = item;
+    }
 
     return ret;
 }
@@ -286,7 +1001,7 @@ void po_insert_at( po_t po, po_pos_t pos, po_d item )
     po_size_t new_used = po->used + 1;
 
     if ( new_used > pm_size( po ) ) {
-        po_resize_to( po, po_incr_size( po ) );
+        po_resize_to( po, po_incr_size( po, new_used ) );
     }
     po_insert_if( po, pos, item );
 }
@@ -296,6 +1011,8 @@ int po_insert_if( po_t po, po_pos_t pos, po_d item )
 {
     po_size_t new_used = po->used + 1;
 
+    pm_own( po );
+
     if ( new_used > pm_size( po ) ) {
         return po_false;
     }
@@ -314,19 +1031,59 @@ int po_insert_if( po_t po, po_pos_t pos, po_d item )
         memmove( &( pm_nth( po, norm + 1 ) ),
                  &( pm_nth( po, norm ) ),
                  ( po->used - norm ) * po_unit_size );
+        pm_stat_add( move_bytes, ( po->used - norm ) * po_unit_size );
     } else if ( norm > po->used ) {
         po_assert( 0 ); // GCOV_EXCL_LINE
     }
 
     pm_nth( po, norm ) = item;
     po->used = new_used;
+    pm_stat_max( peak_used, new_used );
+
+    if ( pm_indexed( po ) ) {
+        po_index_shift( po, norm, 1 );
+        po_index_add( po, norm );
+    }
 
     return po_true;
 }
 
 
+void po_insert_n_at( po_t po, po_pos_t pos, const po_d* items, po_size_t count )
+{
+    po_size_t norm;
+
+    pm_own( po );
+
+    if ( count == 0 ) {
+        return;
+    }
+
+    if ( pos == (po_pos_t)( po->used ) ) {
+        norm = pos;
+    } else {
+        norm = po_norm_idx( po, pos );
+    }
+
+    po_reserve_for( po, po->used + count );
+
+    if ( norm < po->used ) {
+        memmove( &( pm_nth( po, norm + count ) ),
+                 &( pm_nth( po, norm ) ),
+                 ( po->used - norm ) * po_unit_size );
+        pm_stat_add( move_bytes, ( po->used - norm ) * po_unit_size );
+    }
+
+    memcpy( &( pm_nth( po, norm ) ), items, count * po_unit_size );
+    po->used += count;
+    po_index_sync( po );
+}
+
+
 po_d po_delete_at( po_t po, po_pos_t pos )
 {
+    pm_own( po );
+
     if ( pm_empty( po ) ) {
         return NULL;
     }
@@ -338,398 +1095,3610 @@ po_d po_delete_at( po_t po, po_pos_t pos )
         ret = po_first( po );
         po->used = 0;
         pm_first( po ) = NULL;
+        po_index_clear( po );
+        if ( pm_shrink( po ) ) {
+            po_shrink_auto( po );
+        }
         return NULL;
     }
 
     po_size_t norm = po_norm_idx( po, pos );
 
     ret = pm_nth( po, norm );
+    if ( pm_indexed( po ) ) {
+        po_index_del( po, norm );
+    }
     memmove( &( pm_nth( po, norm ) ),
              &( pm_nth( po, norm + 1 ) ),
              ( po->used - ( norm + 1 ) ) * po_unit_size );
+    pm_stat_add( move_bytes, ( po->used - ( norm + 1 ) ) * po_unit_size );
 
     po->used = new_used;
 
+    if ( pm_indexed( po ) ) {
+        po_index_shift( po, norm, -1 );
+    }
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
+    }
+
     return ret;
 }
 
 
-void po_sort( po_t po, po_compare_fn_p compare )
+po_d po_delete_unordered( po_t po, po_pos_t pos )
 {
-    qsort( po->data, po->used, po_unit_size, (int ( * )( const void*, const void* ))compare );
-}
+    pm_own( po );
 
+    if ( pm_empty( po ) ) {
+        return NULL;
+    }
 
-po_d po_alloc_bytes( po_t po, po_size_t bytes )
-{
-    po_d      ret;
-    po_size_t units;
+    po_size_t norm = po_norm_idx( po, pos );
+    po_size_t last = po->used - 1;
+    po_d      ret = pm_nth( po, norm );
 
-    ret = NULL;
-    units = ( bytes >> 3 ) + ( ( bytes & 0x07ULL ) != 0 );
+    if ( pm_indexed( po ) ) {
+        po_index_del( po, norm );
+        if ( norm != last ) {
+            po_index_move( po, last, norm );
+        }
+    }
 
-    if ( po->size >= ( po->used + units ) ) {
-        ret = &po->data[ po->used ];
-        po->used += units;
+    pm_nth( po, norm ) = pm_nth( po, last );
+    po->used = last;
+    if ( pm_empty( po ) ) {
+        pm_first( po ) = NULL;
+    }
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
     }
 
     return ret;
 }
 
 
-/* ------------------------------------------------------------
- * Queries:
- */
-
-po_size_t po_used( po_t po )
+po_size_t po_delete_range( po_t po, po_pos_t pos, po_size_t count )
 {
-    return po->used;
-}
+    pm_own( po );
+
+    if ( pm_empty( po ) || count == 0 ) {
+        return 0;
+    }
 
+    po_size_t norm = po_norm_idx( po, pos );
 
-po_size_t po_size( po_t po )
-{
-    return pm_size( po );
+    if ( count > po->used - norm ) {
+        count = po->used - norm;
+    }
+
+    memmove( &( pm_nth( po, norm ) ),
+             &( pm_nth( po, norm + count ) ),
+             ( po->used - ( norm + count ) ) * po_unit_size );
+    pm_stat_add( move_bytes, ( po->used - ( norm + count ) ) * po_unit_size );
+
+    po->used -= count;
+    if ( pm_empty( po ) ) {
+        pm_first( po ) = NULL;
+    }
+    po_index_sync( po );
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
+    }
+
+    return count;
 }
 
 
-po_size_t po_bytesize( po_t po )
+po_size_t po_filter( po_t po, po_pred_fn_p keep, po_d state )
 {
-    return po_unit_size * pm_size( po );
+    return po_compact( po, keep, state, po_true );
 }
 
 
-po_d* po_data( po_t po )
+po_size_t po_remove_if( po_t po, po_pred_fn_p match, po_d state )
 {
-    return po->data;
+    return po_compact( po, match, state, po_false );
 }
 
-po_d po_first( po_t po )
+
+void po_sort( po_t po, po_compare_fn_p compare )
 {
-    return pm_first( po );
+    pm_own( po );
+
+    po_sort_cb( po->data, po->used, compare );
+    po_index_sync( po );
 }
 
-po_d po_last( po_t po )
+
+int po_sort_parallel( po_t po, po_compare_fn_p compare, po_size_t threads )
 {
-    if ( pm_any( po ) ) {
-        return pm_last( po );
-    } else {
-        return NULL;
+    po_size_t      n = po->used;
+    po_size_t      bounds[ PO_MAX_THREADS + 1 ];
+    po_sort_task_s tasks[ 2 * PO_MAX_THREADS ];
+    po_size_t      count;
+    po_d*          buf;
+    po_d*          src;
+    po_d*          dst;
+
+    pm_own( po );
+
+    threads = po_thread_count( threads, n );
+    if ( threads < 2 ) {
+        po_sort( po, compare );
+        return po_true;
     }
-}
 
-po_d po_nth( po_t po, po_pos_t pos )
-{
-    if ( pm_any( po ) ) {
-        po_size_t idx;
-        idx = po_norm_idx( po, pos );
-        return po->data[ idx ];
-    } else {
-        return NULL;
+    buf = po_malloc( n * po_unit_size );
+    if ( buf == NULL ) {
+        return po_false;
     }
-}
 
-po_d* po_nth_ref( po_t po, po_pos_t pos )
-{
-    if ( pm_any( po ) ) {
-        po_size_t idx;
-        idx = po_norm_idx( po, pos );
-        return &po->data[ idx ];
-    } else {
-        return NULL;
+    /* Sort chunks. */
+    for ( po_size_t t = 0; t <= threads; t++ ) {
+        bounds[ t ] = n * t / threads;
+    }
+    for ( po_size_t t = 0; t < threads; t++ ) {
+        tasks[ t ].src = po->data;
+        tasks[ t ].a = bounds[ t ];
+        tasks[ t ].e = bounds[ t + 1 ];
+        tasks[ t ].compare = compare;
+    }
+    po_run_tasks( po_sort_task, tasks, sizeof( po_sort_task_s ), threads );
+
+    /* Merge pairs of runs, with each merge split to parts. */
+    src = po->data;
+    dst = buf;
+    for ( po_size_t w = 1; w < threads; w *= 2 ) {
+        count = 0;
+        for ( po_size_t t = 0; t < threads; t += 2 * w ) {
+            po_size_t a = bounds[ t ];
+            po_size_t m = bounds[ ( t + w < threads ) ? t + w : threads ];
+            po_size_t e = bounds[ ( t + 2 * w < threads ) ? t + 2 * w : threads ];
+            po_size_t parts = ( threads * ( e - a ) + n - 1 ) / n;
+            for ( po_size_t p = 0; p < parts; p++ ) {
+                tasks[ count ].src = src;
+                tasks[ count ].dst = dst;
+                tasks[ count ].a = a;
+                tasks[ count ].m = m;
+                tasks[ count ].e = e;
+                tasks[ count ].k0 = ( e - a ) * p / parts;
+                tasks[ count ].k1 = ( e - a ) * ( p + 1 ) / parts;
+                tasks[ count ].compare = compare;
+                count++;
+            }
+        }
+        po_run_tasks( po_merge_task, tasks, sizeof( po_sort_task_s ), count );
+        po_d* tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if ( src != po->data ) {
+        memcpy( po->data, src, n * po_unit_size );
     }
+    po_free( buf );
+    po_index_sync( po );
+
+    return po_true;
 }
 
 
-int po_is_empty( po_t po )
+int po_sort_by_key( po_t po, po_key_fn_p key, po_d state )
 {
-    if ( po->data == NULL ) {
-        return po_false;
-    }
+    po_size_t   n = po->used;
+    po_keyed_s* src;
+    po_keyed_s* dst;
+    po_keyed_s* tmp;
+    po_size_t   count[ 8 ][ 256 ];
 
-    if ( po->used <= 0 ) {
+    pm_own( po );
+
+    if ( n < 2 ) {
         return po_true;
-    } else {
+    }
+
+    src = po_malloc( 2 * n * sizeof( po_keyed_s ) );
+    if ( src == NULL ) {
         return po_false;
     }
-}
+    dst = src + n;
+
+    /* Extract keys and count all byte histograms in one pass. */
+    memset( count, 0, sizeof( count ) );
+    for ( po_size_t i = 0; i < n; i++ ) {
+        uint64_t k = key( pm_nth( po, i ), state );
+        src[ i ].key = k;
+        src[ i ].item = pm_nth( po, i );
+        for ( int b = 0; b < 8; b++ ) {
+            count[ b ][ ( k >> ( 8 * b ) ) & 0xFF ]++;
+        }
+    }
 
+    /* LSD radix passes, skipping bytes that are same for all keys. */
+    for ( int b = 0; b < 8; b++ ) {
+        po_size_t* c = count[ b ];
+        po_size_t  sum = 0;
 
-int po_is_full( po_t po )
-{
-    if ( po->data == NULL ) {
-        return po_false;
+        if ( c[ ( src[ 0 ].key >> ( 8 * b ) ) & 0xFF ] == n ) {
+            continue;
+        }
+
+        for ( int i = 0; i < 256; i++ ) {
+            po_size_t t = c[ i ];
+            c[ i ] = sum;
+            sum += t;
+        }
+
+        for ( po_size_t i = 0; i < n; i++ ) {
+            dst[ c[ ( src[ i ].key >> ( 8 * b ) ) & 0xFF ]++ ] = src[ i ];
+        }
+
+        tmp = src;
+        src = dst;
+        dst = tmp;
     }
 
-    if ( po->used >= pm_size( po ) ) {
-        return po_true;
-    } else {
-        return po_false;
+    for ( po_size_t i = 0; i < n; i++ ) {
+        pm_nth( po, i ) = src[ i ].item;
     }
+    po_index_sync( po );
+
+    /* Release the allocation, i.e. the lower one of the buffers. */
+    po_free( src < dst ? src : dst );
+
+    return po_true;
 }
 
 
-po_pos_t po_find( po_t po, po_d item )
+po_pos_t po_bsearch( po_t po, po_compare_fn_p compare, po_d ref )
 {
-    for ( po_size_t i = 0; i < po->used; i++ ) {
-        if ( pm_nth( po, i ) == item ) {
-            return i;
-        }
+    po_size_t idx;
+
+    idx = po_bound( po, compare, ref, po_false );
+    if ( idx < po->used && compare( &( pm_nth( po, idx ) ), &ref ) == 0 ) {
+        return idx;
     }
 
     return PO_NOT_INDEX;
 }
 
 
-po_pos_t po_find_with( po_t po, po_compare_fn_p compare, po_d ref )
+po_size_t po_lower_bound( po_t po, po_compare_fn_p compare, po_d ref )
 {
-    for ( po_size_t i = 0; i < po->used; i++ ) {
-        if ( compare( pm_nth( po, i ), ref ) ) {
-            return i;
-        }
-    }
+    return po_bound( po, compare, ref, po_false );
+}
 
-    return PO_NOT_INDEX;
+
+po_size_t po_upper_bound( po_t po, po_compare_fn_p compare, po_d ref )
+{
+    return po_bound( po, compare, ref, po_true );
 }
 
 
-void po_set_local( po_t po, int val )
+po_size_t po_insert_sorted( po_t po, po_compare_fn_p compare, po_d item )
 {
-    if ( val != 0 ) {
-        po->size = po->size | po_lbms;
-    } else {
-        po->size = po->size & po_lbmc;
-    }
+    po_size_t idx;
+
+    idx = po_bound( po, compare, item, po_true );
+    po_insert_at( po, idx, item );
+
+    return idx;
 }
 
 
-int po_get_local( po_t po )
+po_d po_alloc_bytes( po_t po, po_size_t bytes )
 {
-    return po_local( po );
+    return po_alloc_aligned( po, bytes, sizeof( po_d ) );
 }
 
 
+po_d po_alloc_aligned( po_t po, po_size_t bytes, po_size_t align )
+{
+    po_d      ret;
+    po_size_t units;
+    po_size_t pad;
 
-/* ------------------------------------------------------------
- * Utilities:
- */
+    pm_own( po );
 
+    if ( align < sizeof( po_d ) ) {
+        align = sizeof( po_d );
+    }
+    po_assert( ( align & ( align - 1 ) ) == 0 );
 
-po_size_t po_alloc_pages( po_size_t count, po_d** mem )
-{
-    if ( count == 0 ) {
-        return sysconf( _SC_PAGESIZE );
+    ret = NULL;
+    units = ( bytes >> 3 ) + ( ( bytes & 0x07ULL ) != 0 );
+    pad = pm_byte2unit( -(uintptr_t)&po->data[ po->used ] & ( align - 1 ) );
+
+    if ( pm_size( po ) < ( po->used + pad + units ) ) {
+        /* New block is page aligned, reserve padding only beyond page. */
+        pad = ( align > po_alloc_pages( 0, NULL ) ) ? pm_byte2unit( align ) : 0;
+        if ( !po_arena_grow( po, units + pad ) ) {
+            return ret;
+        }
+        pad = pm_byte2unit( -(uintptr_t)&po->data[ po->used ] & ( align - 1 ) );
     }
 
-    po_size_t page_size;
-    page_size = sysconf( _SC_PAGESIZE );
+    ret = &po->data[ po->used + pad ];
+    po->used += pad + units;
 
-    if ( !posix_memalign( (void**)mem, page_size, count * page_size ) ) {
-        memset( *mem, 0, count * page_size );
-        return count * page_size;
-    } else {
-        po_assert( 0 ); // GCOV_EXCL_LINE
+    return ret;
+}
+
+
+po_d po_alloc_array( po_t po, po_size_t count, po_size_t elem_size, po_size_t align )
+{
+    po_size_t bytes;
+
+    if ( __builtin_mul_overflow( count, elem_size, &bytes ) ) {
+        return NULL;
     }
 
-    return 0;
+    return po_alloc_aligned( po, bytes, align );
 }
 
 
+po_mark_s po_arena_mark( po_t po )
+{
+    po_mark_s mark;
 
-/* ------------------------------------------------------------
- * Internal support:
- */
+    mark.block = ( po->ext ) ? po->ext->block_used : 0;
+    mark.used = po->used;
 
+    return mark;
+}
 
-/** 
- * Allocate Postor descriptor if po is non-NULL.
- * 
- * Return NULL on allocation failure.
- *
- * @param po Postor or NULL.
- * 
- * @return Postor or NULL.
- */
-static po_t po_allocate_descriptor_if( po_t po )
+
+void po_arena_rewind( po_t po, po_mark_s mark )
 {
-    if ( po == NULL ) {
-        po = po_malloc( sizeof( po_s ) );
+    po_size_t         used = po->used;
+    po_arena_block_s* block;
+
+    while ( po->ext && po->ext->block_used > mark.block ) {
+        /* Drop current block and continue from retired one. */
+        po_free( po->data );
+        block = &po->ext->blocks[ --po->ext->block_used ];
+        po->data = block->data;
+        po_set_size( po, block->size );
+        used = block->used;
     }
-    return po;
+
+    if ( used > mark.used && pm_clear( po ) ) {
+        memset( &( pm_nth( po, mark.used ) ), 0, pm_unit2byte( used - mark.used ) );
+    }
+    po->used = mark.used;
 }
 
 
-/** 
- * Set size for Postor, without touching the "local" info.
+void po_arena_release( po_t po )
+{
+    po_mark_s mark = { 0, 0 };
+
+    po_arena_rewind( po, mark );
+}
+
+
+/* ------------------------------------------------------------
+ * Concurrent Postor:
+ */
+
+
+/** @cond postor_none */
+
+/* Segment and segment offset of index, i.e. index + base has MSB at
+ * segment "k" bit above base, and the rest is the offset. */
+#define pm_cc_seg( cc, idx )  ( 63 - __builtin_clzll( ( idx ) + ( cc )->base ) - __builtin_ctzll( ( cc )->base ) )
+#define pm_cc_off( cc, idx, k ) ( ( ( idx ) + ( cc )->base ) - ( ( cc )->base << ( k ) ) )
+
+/** @endcond postor_none */
+
+
+po_cc_t po_cc_new( po_cc_t cc, po_size_t base )
+{
+    po_size_t b = PO_MIN_SIZE;
+    po_cc_t   heap = NULL;
+
+    if ( cc == NULL ) {
+        cc = heap = po_malloc( sizeof( po_cc_s ) );
+        if ( cc == NULL ) {
+            return cc;
+        }
+    }
+
+    while ( b < base ) {
+        b <<= 1;
+    }
+
+    memset( cc, 0, sizeof( po_cc_s ) );
+    cc->base = b;
+    if ( po_cc_segment( cc, 0 ) == NULL ) {
+        // GCOV_EXCL_START
+        po_free( heap );
+        return NULL;
+        // GCOV_EXCL_STOP
+    }
+
+    return cc;
+}
+
+
+void po_cc_destroy_storage( po_cc_t cc )
+{
+    for ( int k = 0; k < PO_CC_SEGMENTS; k++ ) {
+        po_free( cc->seg[ k ] );
+        cc->seg[ k ] = NULL;
+    }
+    cc->used = 0;
+}
+
+
+po_cc_t po_cc_destroy( po_cc_t cc )
+{
+    if ( cc ) {
+        po_cc_destroy_storage( cc );
+        po_free( cc );
+    }
+
+    return NULL;
+}
+
+
+po_size_t po_cc_push( po_cc_t cc, po_d item )
+{
+    po_size_t idx;
+    po_size_t k;
+    po_d*     seg;
+
+    idx = __atomic_fetch_add( &cc->used, 1, __ATOMIC_RELAXED );
+    k = pm_cc_seg( cc, idx );
+    if ( k >= PO_CC_SEGMENTS ) {
+        return PO_NOT_INDEX;
+    }
+
+    /* Slot stays unpublished (NULL), if segment can not be allocated. */
+    seg = po_cc_segment( cc, k );
+    if ( seg == NULL ) {
+        return PO_NOT_INDEX; // GCOV_EXCL_LINE
+    }
+    __atomic_store_n( &seg[ pm_cc_off( cc, idx, k ) ], item, __ATOMIC_RELEASE );
+
+    return idx;
+}
+
+
+po_d po_cc_nth( po_cc_t cc, po_size_t idx )
+{
+    po_size_t k;
+    po_d*     seg;
+
+    if ( idx >= __atomic_load_n( &cc->used, __ATOMIC_RELAXED ) ) {
+        return NULL;
+    }
+
+    k = pm_cc_seg( cc, idx );
+    seg = __atomic_load_n( &cc->seg[ k ], __ATOMIC_ACQUIRE );
+    if ( seg == NULL ) {
+        return NULL;
+    }
+
+    return __atomic_load_n( &seg[ pm_cc_off( cc, idx, k ) ], __ATOMIC_ACQUIRE );
+}
+
+
+po_size_t po_cc_used( po_cc_t cc )
+{
+    return __atomic_load_n( &cc->used, __ATOMIC_RELAXED );
+}
+
+
+po_size_t po_cc_collect( po_cc_t cc, po_t po )
+{
+    po_size_t used = po_cc_used( cc );
+    po_size_t count = 0;
+    po_size_t idx = 0;
+
+    for ( int k = 0; idx < used; k++ ) {
+        po_size_t len = cc->base << k;
+        po_d*     seg = __atomic_load_n( &cc->seg[ k ], __ATOMIC_ACQUIRE );
+
+        if ( len > used - idx ) {
+            len = used - idx;
+        }
+
+        for ( po_size_t i = 0; seg && i < len; i++ ) {
+            po_d item = __atomic_load_n( &seg[ i ], __ATOMIC_ACQUIRE );
+            if ( item ) {
+                po_push( po, item );
+                count++;
+            }
+        }
+
+        idx += len;
+    }
+
+    return count;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Ring Postor (SPSC):
+ */
+
+
+po_spsc_t po_spsc_new( po_spsc_t sp, po_size_t size )
+{
+    po_size_t slots = PO_MIN_SIZE;
+
+    if ( sp == NULL ) {
+        sp = po_malloc( sizeof( po_spsc_s ) );
+        if ( sp == NULL ) {
+            return sp;
+        }
+    }
+
+    while ( slots < size ) {
+        slots <<= 1;
+    }
+
+    memset( sp, 0, sizeof( po_spsc_s ) );
+    sp->data = po_malloc( pm_unit2byte( slots ) );
+    sp->mask = slots - 1;
+
+    return sp;
+}
+
+
+void po_spsc_destroy_storage( po_spsc_t sp )
+{
+    po_free( sp->data );
+    sp->data = NULL;
+    sp->head = sp->tail = 0;
+    sp->head_cache = sp->tail_cache = 0;
+}
+
+
+po_spsc_t po_spsc_destroy( po_spsc_t sp )
+{
+    if ( sp ) {
+        po_spsc_destroy_storage( sp );
+        po_free( sp );
+    }
+
+    return NULL;
+}
+
+
+int po_spsc_push( po_spsc_t sp, po_d item )
+{
+    po_size_t tail = sp->tail;
+
+    if ( tail - sp->head_cache > sp->mask ) {
+        sp->head_cache = __atomic_load_n( &sp->head, __ATOMIC_ACQUIRE );
+        if ( tail - sp->head_cache > sp->mask ) {
+            return po_false;
+        }
+    }
+
+    sp->data[ tail & sp->mask ] = item;
+    __atomic_store_n( &sp->tail, tail + 1, __ATOMIC_RELEASE );
+
+    return po_true;
+}
+
+
+po_d po_spsc_pop( po_spsc_t sp )
+{
+    po_size_t head = sp->head;
+    po_d      item;
+
+    if ( head == sp->tail_cache ) {
+        sp->tail_cache = __atomic_load_n( &sp->tail, __ATOMIC_ACQUIRE );
+        if ( head == sp->tail_cache ) {
+            return NULL;
+        }
+    }
+
+    item = sp->data[ head & sp->mask ];
+    __atomic_store_n( &sp->head, head + 1, __ATOMIC_RELEASE );
+
+    return item;
+}
+
+
+po_size_t po_spsc_used( po_spsc_t sp )
+{
+    po_size_t head = __atomic_load_n( &sp->head, __ATOMIC_ACQUIRE );
+    po_size_t tail = __atomic_load_n( &sp->tail, __ATOMIC_ACQUIRE );
+
+    return tail - head;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Segmented Postor:
+ */
+
+
+po_seg_t po_seg_new( po_seg_t sg, po_size_t chunk )
+{
+    if ( sg == NULL ) {
+        sg = po_malloc( sizeof( po_seg_s ) );
+        if ( sg == NULL ) {
+            return sg;
+        }
+    }
+
+    if ( chunk == 0 ) {
+        chunk = PO_SEG_CHUNK;
+    }
+
+    sg->shift = 1;
+    while ( ( 1ULL << sg->shift ) < chunk ) {
+        sg->shift++;
+    }
+    sg->used = 0;
+    po_new_descriptor( &sg->dir );
+
+    return sg;
+}
+
+
+void po_seg_destroy_storage( po_seg_t sg )
+{
+    for ( po_size_t k = 0; k < sg->dir.used; k++ ) {
+        po_free( pm_seg_chunk( sg, k ) );
+    }
+    po_destroy_storage( &sg->dir );
+    sg->dir.used = 0;
+    sg->used = 0;
+}
+
+
+po_seg_t po_seg_destroy( po_seg_t sg )
+{
+    if ( sg ) {
+        po_seg_destroy_storage( sg );
+        po_free( sg );
+    }
+
+    return NULL;
+}
+
+
+int po_seg_push( po_seg_t sg, po_d item )
+{
+    po_size_t k = sg->used >> sg->shift;
+
+    if ( k == sg->dir.used ) {
+        /* Add chunk, existing chunks are not moved. */
+        po_d* chunk = po_malloc( pm_unit2byte( 1ULL << sg->shift ) );
+        if ( chunk == NULL ) {
+            return po_false; // GCOV_EXCL_LINE
+        }
+        po_push( &sg->dir, chunk );
+    }
+
+    pm_seg_chunk( sg, k )[ sg->used & pm_seg_mask( sg ) ] = item;
+    sg->used++;
+
+    return po_true;
+}
+
+
+po_d po_seg_pop( po_seg_t sg )
+{
+    if ( sg->used == 0 ) {
+        return NULL;
+    }
+
+    sg->used--;
+
+    return pm_seg_chunk( sg, sg->used >> sg->shift )[ sg->used & pm_seg_mask( sg ) ];
+}
+
+
+po_d po_seg_nth( po_seg_t sg, po_size_t idx )
+{
+    po_d* ref = po_seg_nth_ref( sg, idx );
+
+    return ref ? *ref : NULL;
+}
+
+
+po_d* po_seg_nth_ref( po_seg_t sg, po_size_t idx )
+{
+    if ( idx >= sg->used ) {
+        return NULL;
+    }
+
+    return &pm_seg_chunk( sg, idx >> sg->shift )[ idx & pm_seg_mask( sg ) ];
+}
+
+
+po_size_t po_seg_used( po_seg_t sg )
+{
+    return sg->used;
+}
+
+
+po_d* po_seg_chunk( po_seg_t sg, po_size_t k, po_size_t* count )
+{
+    po_size_t first = k << sg->shift;
+
+    if ( first >= sg->used ) {
+        *count = 0;
+        return NULL;
+    }
+
+    *count = sg->used - first;
+    if ( *count > ( 1ULL << sg->shift ) ) {
+        *count = 1ULL << sg->shift;
+    }
+
+    return pm_seg_chunk( sg, k );
+}
+
+
+void po_seg_reset( po_seg_t sg )
+{
+    sg->used = 0;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Compressed Postor:
+ */
+
+
+/**
+ * Encode item to offset.
+ *
+ * @param cp   Compressed Postor.
+ * @param item Item.
+ * @param off  Offset (output).
+ *
+ * @return 1 if item fits.
+ */
+static int po_cp_encode( po_cp_t cp, po_d item, uint32_t* off )
+{
+    uintptr_t diff;
+
+    if ( item == NULL ) {
+        *off = 0;
+        return po_true;
+    }
+
+    if ( (char*)item < cp->base ) {
+        return po_false;
+    }
+
+    diff = (char*)item - cp->base;
+    if ( diff & ( ( 1ULL << cp->shift ) - 1 ) ) {
+        return po_false;
+    }
+
+    diff >>= cp->shift;
+    if ( diff >= UINT32_MAX ) {
+        return po_false;
+    }
+
+    *off = (uint32_t)diff + 1;
+
+    return po_true;
+}
+
+
+/**
+ * Decode offset to item.
+ *
+ * @param cp  Compressed Postor.
+ * @param off Offset.
+ *
+ * @return Item.
+ */
+static inline po_d po_cp_decode( po_cp_t cp, uint32_t off )
+{
+    if ( off == 0 ) {
+        return NULL;
+    }
+
+    return cp->base + ( (po_size_t)( off - 1 ) << cp->shift );
+}
+
+
+po_cp_t po_cp_new( po_cp_t cp, void* base, po_size_t shift )
+{
+    po_assert( shift <= 3 );
+
+    if ( cp == NULL ) {
+        cp = po_malloc( sizeof( po_cp_s ) );
+        if ( cp == NULL ) {
+            return cp;
+        }
+    }
+
+    memset( cp, 0, sizeof( po_cp_s ) );
+    cp->base = base;
+    cp->shift = shift;
+
+    return cp;
+}
+
+
+void po_cp_destroy_storage( po_cp_t cp )
+{
+    po_free( cp->data );
+    cp->data = NULL;
+    cp->size = 0;
+    cp->used = 0;
+}
+
+
+po_cp_t po_cp_destroy( po_cp_t cp )
+{
+    if ( cp ) {
+        po_cp_destroy_storage( cp );
+        po_free( cp );
+    }
+
+    return NULL;
+}
+
+
+int po_cp_fits( po_cp_t cp, po_d item )
+{
+    uint32_t off;
+
+    return po_cp_encode( cp, item, &off );
+}
+
+
+int po_cp_push( po_cp_t cp, po_d item )
+{
+    uint32_t off;
+
+    if ( !po_cp_encode( cp, item, &off ) ) {
+        return po_false;
+    }
+
+    if ( cp->used >= cp->size ) {
+        po_size_t size = cp->size ? 2 * cp->size : 2 * PO_DEFAULT_SIZE;
+        uint32_t* data = po_realloc( cp->data, size * sizeof( uint32_t ) );
+        if ( data == NULL ) {
+            return po_false; // GCOV_EXCL_LINE
+        }
+        cp->data = data;
+        cp->size = size;
+    }
+
+    cp->data[ cp->used++ ] = off;
+
+    return po_true;
+}
+
+
+po_d po_cp_pop( po_cp_t cp )
+{
+    if ( cp->used == 0 ) {
+        return NULL;
+    }
+
+    return po_cp_decode( cp, cp->data[ --cp->used ] );
+}
+
+
+po_d po_cp_nth( po_cp_t cp, po_size_t idx )
+{
+    if ( idx >= cp->used ) {
+        return NULL;
+    }
+
+    return po_cp_decode( cp, cp->data[ idx ] );
+}
+
+
+po_pos_t po_cp_find( po_cp_t cp, po_d item )
+{
+    uint32_t off;
+
+    if ( !po_cp_encode( cp, item, &off ) ) {
+        return PO_NOT_INDEX;
+    }
+
+    for ( po_size_t i = 0; i < cp->used; i++ ) {
+        if ( cp->data[ i ] == off ) {
+            pm_stat_add( compares, i + 1 );
+            return i;
+        }
+    }
+    pm_stat_add( compares, cp->used );
+
+    return PO_NOT_INDEX;
+}
+
+
+po_size_t po_cp_used( po_cp_t cp )
+{
+    return cp->used;
+}
+
+
+void po_cp_reset( po_cp_t cp )
+{
+    cp->used = 0;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Record Postor:
+ */
+
+
+/**
+ * Return record capacity.
+ *
+ * @param rc Record Postor.
+ *
+ * @return Capacity.
+ */
+static inline po_size_t po_rec_cap( po_rec_t rc )
+{
+    return pm_size( rc->po ) / rc->width;
+}
+
+
+/**
+ * Reserve storage for one more record.
+ *
+ * Columns are moved apart after resize, last column first.
+ *
+ * @param rc Record Postor.
+ */
+static void po_rec_reserve( po_rec_t rc )
+{
+    po_size_t old_cap = po_rec_cap( rc );
+    po_size_t new_cap;
+    po_d*     data;
+
+    if ( rc->used < old_cap ) {
+        return;
+    }
+
+    if ( rc->soa ) {
+        /* Columns span storage: keep all in local spill. */
+        rc->po->used = old_cap * rc->width;
+    }
+    po_reserve_for( rc->po, ( rc->used + 1 ) * rc->width );
+
+    new_cap = po_rec_cap( rc );
+    data = rc->po->data;
+    if ( rc->soa ) {
+        for ( po_size_t c = rc->width - 1; c > 0; c-- ) {
+            memmove( &data[ c * new_cap ], &data[ c * old_cap ], pm_unit2byte( rc->used ) );
+            pm_stat_add( move_bytes, pm_unit2byte( rc->used ) );
+        }
+    }
+}
+
+
+/**
+ * Copy record into or out of storage.
+ *
+ * Padding after record in last field is cleared on copy in, since
+ * fields are read as whole.
+ *
+ * @param rc  Record Postor.
+ * @param idx Record index.
+ * @param rec Record.
+ * @param out Copy out of storage.
+ */
+static void po_rec_copy( po_rec_t rc, po_size_t idx, void* rec, int out )
+{
+    po_size_t cap;
+    po_size_t bytes;
+
+    if ( !rc->soa ) {
+        po_d* slot = &rc->po->data[ idx * rc->width ];
+        if ( out ) {
+            memcpy( rec, slot, rc->bytes );
+        } else {
+            slot[ rc->width - 1 ] = NULL;
+            memcpy( slot, rec, rc->bytes );
+        }
+        return;
+    }
+
+    cap = po_rec_cap( rc );
+    for ( po_size_t c = 0; c < rc->width; c++ ) {
+        po_d* slot = &rc->po->data[ c * cap + idx ];
+        bytes = rc->bytes - pm_unit2byte( c );
+        if ( bytes > po_unit_size ) {
+            bytes = po_unit_size;
+        }
+        if ( out ) {
+            memcpy( (char*)rec + pm_unit2byte( c ), slot, bytes );
+        } else {
+            *slot = NULL;
+            memcpy( slot, (char*)rec + pm_unit2byte( c ), bytes );
+        }
+    }
+}
+
+
+po_rec_t po_rec_new( po_rec_t rc, po_t po, po_size_t bytes, int soa )
+{
+    po_assert( po->used == 0 );
+    po_assert( bytes > 0 );
+
+    if ( rc == NULL ) {
+        rc = po_malloc( sizeof( po_rec_s ) );
+        if ( rc == NULL ) {
+            return rc;
+        }
+    }
+
+    rc->po = po;
+    rc->bytes = bytes;
+    rc->width = pm_byte2unit( bytes + po_unit_size - 1 );
+    rc->used = 0;
+    rc->soa = soa;
+
+    return rc;
+}
+
+
+po_rec_t po_rec_destroy( po_rec_t rc )
+{
+    po_free( rc );
+
+    return NULL;
+}
+
+
+po_size_t po_rec_push( po_rec_t rc, const void* rec )
+{
+    po_size_t idx = rc->used;
+
+    po_rec_reserve( rc );
+    rc->used++;
+    rc->po->used = rc->used * rc->width;
+
+    if ( rec ) {
+        po_rec_copy( rc, idx, (void*)rec, 0 );
+    } else {
+        for ( po_size_t c = 0; c < rc->width; c++ ) {
+            *po_rec_field( rc, idx, c ) = 0;
+        }
+    }
+
+    return idx;
+}
+
+
+int po_rec_pop( po_rec_t rc, void* rec )
+{
+    if ( rc->used == 0 ) {
+        return po_false;
+    }
+
+    if ( rec ) {
+        po_rec_copy( rc, rc->used - 1, rec, 1 );
+    }
+    rc->used--;
+    rc->po->used = rc->used * rc->width;
+
+    return po_true;
+}
+
+
+void* po_rec_nth( po_rec_t rc, po_size_t idx )
+{
+    if ( rc->soa || idx >= rc->used ) {
+        return NULL;
+    }
+
+    return &rc->po->data[ idx * rc->width ];
+}
+
+
+int po_rec_get( po_rec_t rc, po_size_t idx, void* rec )
+{
+    if ( idx >= rc->used ) {
+        return po_false;
+    }
+
+    po_rec_copy( rc, idx, rec, 1 );
+
+    return po_true;
+}
+
+
+int po_rec_set( po_rec_t rc, po_size_t idx, const void* rec )
+{
+    if ( idx >= rc->used ) {
+        return po_false;
+    }
+
+    po_rec_copy( rc, idx, (void*)rec, 0 );
+
+    return po_true;
+}
+
+
+uint64_t* po_rec_field( po_rec_t rc, po_size_t idx, po_size_t field )
+{
+    po_size_t stride;
+    uint64_t* col = po_rec_column( rc, field, &stride );
+
+    if ( col == NULL || idx >= rc->used ) {
+        return NULL;
+    }
+
+    return &col[ idx * stride ];
+}
+
+
+uint64_t* po_rec_column( po_rec_t rc, po_size_t field, po_size_t* stride )
+{
+    if ( field >= rc->width || rc->po->data == NULL ) {
+        return NULL;
+    }
+
+    if ( rc->soa ) {
+        *stride = 1;
+        return (uint64_t*)&rc->po->data[ field * po_rec_cap( rc ) ];
+    } else {
+        *stride = rc->width;
+        return (uint64_t*)&rc->po->data[ field ];
+    }
+}
+
+
+po_size_t po_rec_used( po_rec_t rc )
+{
+    return rc->used;
+}
+
+
+void po_rec_reset( po_rec_t rc )
+{
+    rc->used = 0;
+    rc->po->used = 0;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Queries:
+ */
+
+po_size_t po_used( po_t po )
+{
+    return po->used;
+}
+
+
+po_size_t po_size( po_t po )
+{
+    return pm_size( po );
+}
+
+
+po_size_t po_bytesize( po_t po )
+{
+    return po_unit_size * pm_size( po );
+}
+
+
+po_d* po_data( po_t po )
+{
+    return po->data;
+}
+
+po_d po_first( po_t po )
+{
+    if ( pm_any( po ) ) {
+        return pm_first( po );
+    } else {
+        return NULL;
+    }
+}
+
+po_d po_last( po_t po )
+{
+    if ( pm_any( po ) ) {
+        return pm_last( po );
+    } else {
+        return NULL;
+    }
+}
+
+po_d po_nth( po_t po, po_pos_t pos )
+{
+    if ( pm_any( po ) ) {
+        po_size_t idx;
+        idx = po_norm_idx( po, pos );
+        return po->data[ idx ];
+    } else {
+        return NULL;
+    }
+}
+
+po_d* po_nth_ref( po_t po, po_pos_t pos )
+{
+    pm_own( po );
+
+    if ( pm_any( po ) ) {
+        po_size_t idx;
+        idx = po_norm_idx( po, pos );
+        return &po->data[ idx ];
+    } else {
+        return NULL;
+    }
+}
+
+
+int po_is_empty( po_t po )
+{
+    if ( po->data == NULL ) {
+        return po_false;
+    }
+
+    if ( po->used <= 0 ) {
+        return po_true;
+    } else {
+        return po_false;
+    }
+}
+
+
+int po_is_full( po_t po )
+{
+    if ( po->data == NULL ) {
+        return po_false;
+    }
+
+    if ( po->used >= pm_size( po ) ) {
+        return po_true;
+    } else {
+        return po_false;
+    }
+}
+
+
+po_pos_t po_find( po_t po, po_d item )
+{
+    po_size_t idx;
+
+    if ( pm_indexed( po ) && po->ext->index->equal == NULL ) {
+        idx = po_index_lookup( po, item );
+    } else {
+        idx = po_find_kernel()->find( po->data, po->used, item );
+        pm_stat_add( compares, idx < po->used ? idx + 1 : po->used );
+    }
+    if ( idx < po->used ) {
+        return idx;
+    }
+
+    return PO_NOT_INDEX;
+}
+
+
+po_pos_t po_find_last( po_t po, po_d item )
+{
+    po_size_t idx;
+
+    idx = po_find_kernel()->find_last( po->data, po->used, item );
+    pm_stat_add( compares, idx < po->used ? po->used - idx : po->used );
+    if ( idx < po->used ) {
+        return idx;
+    }
+
+    return PO_NOT_INDEX;
+}
+
+
+po_size_t po_count( po_t po, po_d item )
+{
+    pm_stat_add( compares, po->used );
+    return po_find_kernel()->count( po->data, po->used, item );
+}
+
+
+po_pos_t po_find_with( po_t po, po_compare_fn_p compare, po_d ref )
+{
+    for ( po_size_t i = 0; i < po->used; i++ ) {
+        if ( compare( pm_nth( po, i ), ref ) ) {
+            pm_stat_add( compares, i + 1 );
+            return i;
+        }
+    }
+    pm_stat_add( compares, po->used );
+
+    return PO_NOT_INDEX;
+}
+
+
+po_pos_t po_find_with_parallel( po_t po, po_compare_fn_p compare, po_d ref, po_size_t threads )
+{
+    po_find_task_s tasks[ PO_MAX_THREADS ];
+    po_size_t      best;
+
+    threads = po_thread_count( threads, po->used );
+    if ( threads < 2 ) {
+        return po_find_with( po, compare, ref );
+    }
+
+    best = po->used;
+    for ( po_size_t t = 0; t < threads; t++ ) {
+        tasks[ t ].po = po;
+        tasks[ t ].compare = compare;
+        tasks[ t ].ref = ref;
+        tasks[ t ].beg = po->used * t / threads;
+        tasks[ t ].end = po->used * ( t + 1 ) / threads;
+        tasks[ t ].best = &best;
+    }
+    po_run_tasks( po_find_task, tasks, sizeof( po_find_task_s ), threads );
+
+    if ( best < po->used ) {
+        return best;
+    }
+
+    return PO_NOT_INDEX;
+}
+
+
+int po_index_attach( po_t po, po_hash_fn_p hash, po_compare_fn_p equal )
+{
+    po_x        ext;
+    po_index_s* index;
+
+    ext = po_ext( po );
+    if ( ext == NULL ) {
+        return po_false;
+    }
+
+    po_index_detach( po );
+
+    index = po_malloc( sizeof( po_index_s ) );
+    if ( index == NULL ) {
+        return po_false;
+    }
+    index->hash = hash;
+    index->equal = equal;
+    index->mask = 0;
+    index->slots = NULL;
+    ext->index = index;
+
+    if ( !po_index_build( po, 0 ) ) {
+        po_index_detach( po );
+        return po_false;
+    }
+
+    return po_true;
+}
+
+
+int po_is_indexed( po_t po )
+{
+    return pm_indexed( po );
+}
+
+
+void po_index_detach( po_t po )
+{
+    if ( pm_indexed( po ) ) {
+        po_free( po->ext->index->slots );
+        po_free( po->ext->index );
+        po->ext->index = NULL;
+    }
+}
+
+
+po_pos_t po_index_find( po_t po, po_d ref )
+{
+    po_size_t idx;
+
+    if ( !pm_indexed( po ) ) {
+        if ( po->data == NULL ) {
+            return PO_NOT_INDEX;
+        }
+        return po_find( po, ref );
+    }
+
+    idx = po_index_lookup( po, ref );
+    if ( idx < po->used ) {
+        return idx;
+    }
+
+    return PO_NOT_INDEX;
+}
+
+
+void po_visit( po_t po, po_visit_fn_p fn, po_d state )
+{
+    po_visit_range( po, 0, po->used, fn, state );
+}
+
+
+void po_visit_range( po_t po, po_size_t start, po_size_t end, po_visit_fn_p fn, po_d state )
+{
+    po_d*     data = po->data;
+    po_size_t i;
+
+    if ( end > po->used ) {
+        end = po->used;
+    }
+    if ( start >= end ) {
+        return;
+    }
+
+    for ( i = start; i < end && i < start + PO_PREFETCH_DIST; i++ ) {
+        po_prefetch( data, i, end );
+    }
+
+    /* Blocks of 4, prefetching PO_PREFETCH_DIST items ahead. */
+    for ( i = start; i + 4 <= end; i += 4 ) {
+        po_prefetch( data, i + PO_PREFETCH_DIST, end );
+        po_prefetch( data, i + PO_PREFETCH_DIST + 1, end );
+        po_prefetch( data, i + PO_PREFETCH_DIST + 2, end );
+        po_prefetch( data, i + PO_PREFETCH_DIST + 3, end );
+        fn( data[ i ], state );
+        fn( data[ i + 1 ], state );
+        fn( data[ i + 2 ], state );
+        fn( data[ i + 3 ], state );
+    }
+
+    for ( ; i < end; i++ ) {
+        fn( data[ i ], state );
+    }
+}
+
+
+void po_set_local( po_t po, int val )
+{
+    if ( val != 0 ) {
+        po->size = po->size | po_lbms;
+    } else {
+        po->size = po->size & po_lbmc;
+    }
+}
+
+
+int po_get_local( po_t po )
+{
+    return po_local( po );
+}
+
+
+
+/* ------------------------------------------------------------
+ * Utilities:
+ */
+
+
+void po_stats_get( po_stats_s* stats )
+{
+#ifdef POSTOR_USE_STATS
+    po_size_t* from = (po_size_t*)&po_stats;
+    po_size_t* to = (po_size_t*)stats;
+
+    for ( size_t i = 0; i < sizeof( po_stats_s ) / sizeof( po_size_t ); i++ ) {
+        to[ i ] = __atomic_load_n( &from[ i ], __ATOMIC_RELAXED );
+    }
+#else
+    memset( stats, 0, sizeof( po_stats_s ) );
+#endif
+}
+
+
+void po_stats_reset( void )
+{
+#ifdef POSTOR_USE_STATS
+    po_size_t* field = (po_size_t*)&po_stats;
+
+    for ( size_t i = 0; i < sizeof( po_stats_s ) / sizeof( po_size_t ); i++ ) {
+        __atomic_store_n( &field[ i ], 0, __ATOMIC_RELAXED );
+    }
+#endif
+}
+
+
+void po_pool_trim( void )
+{
+#ifdef POSTOR_USE_POOL
+    po_pool_list_s* cache = po_pool_thread();
+
+    pthread_mutex_lock( &po_pool_lock );
+    for ( int c = 0; c <= PO_POOL_SHIFT; c++ ) {
+        po_pool_release( cache, c, 0 );
+        po_pool_release( &po_pool_depot, c, 0 );
+    }
+    pthread_mutex_unlock( &po_pool_lock );
+#endif
+}
+
+
+po_size_t po_alloc_pages( po_size_t count, po_d** mem )
+{
+    if ( count == 0 ) {
+        return sysconf( _SC_PAGESIZE );
+    }
+
+    po_size_t page_size;
+    page_size = sysconf( _SC_PAGESIZE );
+
+    if ( !posix_memalign( (void**)mem, page_size, count * page_size ) ) {
+#ifndef POSTOR_NO_CLEAR
+        memset( *mem, 0, count * page_size );
+#endif
+        return count * page_size;
+    } else {
+        po_assert( 0 ); // GCOV_EXCL_LINE
+    }
+
+    return 0;
+}
+
+
+
+/* ------------------------------------------------------------
+ * Internal support:
+ */
+
+
+/** 
+ * Allocate Postor descriptor if po is non-NULL.
+ * 
+ * Return NULL on allocation failure.
+ *
+ * @param po Postor or NULL.
+ * 
+ * @return Postor or NULL.
+ */
+static po_t po_allocate_descriptor_if( po_t po )
+{
+    if ( po == NULL ) {
+#ifdef POSTOR_USE_POOL
+        po = po_slab_alloc();
+#else
+        po = po_malloc( sizeof( po_s ) );
+#endif
+    }
+    return po;
+}
+
+
+#ifdef POSTOR_USE_STATS
+
+/**
+ * Update statistics maximum.
+ *
+ * @param field Statistics field.
+ * @param value New value.
+ */
+static void po_stats_max( po_size_t* field, po_size_t value )
+{
+    po_size_t cur = __atomic_load_n( field, __ATOMIC_RELAXED );
+
+    while ( value > cur
+            && !__atomic_compare_exchange_n(
+                field, &cur, value, po_true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+        ;
+}
+
+#endif
+
+
+/**
+ * Free heap allocated Postor descriptor.
+ *
+ * Slab descriptors are recognized by address only, since descriptor
+ * may also be allocated by caller.
+ *
+ * @param po Postor.
+ */
+static void po_free_descriptor( po_t po )
+{
+#ifdef POSTOR_USE_POOL
+    if ( po_slab_owns( po ) ) {
+        po_slab_free( po );
+        return;
+    }
+#endif
+    po_free( po );
+}
+
+
+/**
+ * Return Postor extension, allocate it if missing.
+ *
+ * Return NULL on allocation failure.
+ *
+ * @param po Postor.
+ *
+ * @return Extension (or NULL).
+ */
+static po_x po_ext( po_t po )
+{
+    if ( po->ext == NULL ) {
+        po->ext = po_malloc( sizeof( struct po_ext_s ) );
+        if ( po->ext ) {
+            memset( po->ext, 0, sizeof( struct po_ext_s ) );
+            po->ext->growth = PO_GROW_DOUBLE;
+        }
+    }
+    return po->ext;
+}
+
+
+/**
+ * Copy extension (settings) from Postor to another.
+ *
+ * @param to   Target Postor (without extension).
+ * @param from Source Postor.
+ */
+static void po_ext_copy( po_t to, po_t from )
+{
+    if ( from->ext && po_ext( to ) ) {
+        *( to->ext ) = *( from->ext );
+        to->ext->index = NULL;
+        to->ext->head = 0;
+        to->ext->total = 0;
+        to->ext->arena = po_false;
+        to->ext->map = 0;
+        to->ext->mapped = 0;
+        to->ext->shared = NULL;
+        to->ext->blocks = NULL;
+        to->ext->block_used = 0;
+        to->ext->block_size = 0;
+        if ( from->ext->index ) {
+            po_index_attach( to, from->ext->index->hash, from->ext->index->equal );
+        }
+    }
+}
+
+
+/**
+ * Destroy extension of Postor (if any).
+ *
+ * @param po Postor.
+ */
+static void po_ext_destroy( po_t po )
+{
+    if ( po->ext ) {
+        po_ext_reset( po );
+        po_index_detach( po );
+        po_free( po->ext );
+        po->ext = NULL;
+    }
+}
+
+
+/**
+ * Reset storage state of extension (if any), when storage is
+ * destroyed. Settings are kept, and index is emptied.
+ *
+ * @param po Postor.
+ */
+static void po_ext_reset( po_t po )
+{
+    if ( po->ext ) {
+        po_index_clear( po );
+        for ( po_size_t i = 0; i < po->ext->block_used; i++ ) {
+            po_free( po->ext->blocks[ i ].data );
+        }
+        po_free( po->ext->blocks );
+        po->ext->blocks = NULL;
+        po->ext->block_used = 0;
+        po->ext->block_size = 0;
+        po->ext->head = 0;
+        po->ext->total = 0;
+        po->ext->arena = po_false;
+        po->ext->map = 0;
+        po->ext->mapped = 0;
+        po->ext->shared = NULL;
+    }
+}
+
+
+/**
+ * Check if extension has (non-default) user settings.
+ *
+ * @param po Postor.
+ *
+ * @return 1 if extension has settings.
+ */
+static int po_ext_custom( po_t po )
+{
+    po_x ext = po->ext;
+
+    return ( ext
+             && ( ext->growth != PO_GROW_DOUBLE || ext->resize || ext->noclear || ext->shrink
+                  || ext->index ) );
+}
+
+
+/**
+ * Release reference to shared storage.
+ *
+ * Storage is freed by the last holder.
+ *
+ * @param po   Postor (shared).
+ * @param base Storage to free (or NULL to keep it).
+ */
+static void po_share_release( po_t po, po_d* base )
+{
+    if ( __atomic_sub_fetch( po->ext->shared, 1, __ATOMIC_ACQ_REL ) == 0 ) {
+        po_free( po->ext->shared );
+        if ( base ) {
+            po_store_free( po, base );
+        }
+    }
+    po->ext->shared = NULL;
+}
+
+
+/** 
+ * Set size for Postor, without touching the "local" info.
+ * 
+ * @param po    Postor.
+ * @param size  Size.
+ */
+static void po_set_size( po_t po, po_size_t size )
+{
+    int local;
+
+    local = po_get_local( po );
+    po->size = size;
+    po_set_local( po, local );
+}
+
+
+/** 
+ * Set size and local for Postor.
  * 
+ * @param po     Postor.
+ * @param size   Size.
+ * @param local  Local info.
+ */
+static void po_set_size_and_local( po_t po, po_size_t size, int local )
+{
+    po->size = size;
+    po_set_local( po, local );
+}
+
+
+/**
+ * Initialize Postor struct to given size and local mode.
+ *
+ * @param po    Postor.
+ * @param size  Size (must be already legal).
+ * @param local Local mode.
+ */
+static void po_init( po_t po, po_size_t size, po_d data, int local )
+{
+    po_set_size_and_local( po, size, local );
+    po->used = 0;
+    po->data = data;
+    po->ext = NULL;
+}
+
+
+/**
+ * Align reservation size for 4k and bigger.
+ *
+ * Small reservations are not effected.
+ *
+ * @param new_size    Size to align, if needed.
+ *
+ * @return            Valid size.
+ */
+static po_size_t po_align_size( po_size_t new_size )
+{
+    if ( new_size >= 4096 ) {
+        if ( new_size == 4096 ) {
+            new_size = 4096;
+        } else {
+            new_size = ( ( ( new_size >> 12 ) + 1 ) << 12 );
+        }
+    }
+
+    return new_size;
+}
+
+
+/**
+ * Calculate incremented memory reservation size.
+ *
+ * Reservation size is incremented according to growth policy, and
+ * by default doubled from the existing value. Result is at least
+ * "need".
+ *
+ * @param po   Postor.
+ * @param need Minimum size.
+ *
+ * @return New size.
+ */
+static po_size_t po_incr_size( po_t po, po_size_t need )
+{
+    po_size_t size;
+    po_size_t new_size;
+
+    size = pm_size( po );
+
+    switch ( po_get_growth( po ) ) {
+        case PO_GROW_HALF: new_size = size + ( size >> 1 ); break;
+        case PO_GROW_STEP: new_size = size + po->ext->step; break;
+        case PO_GROW_FN: new_size = po->ext->resize( po, need, po->ext->state ); break;
+        default: new_size = size * 2; break;
+    }
+
+    if ( new_size < need ) {
+        new_size = need;
+    }
+
+    return po_legal_size( new_size );
+}
+
+
+/**
+ * Convert size to a legal Postor size.
+ *
+ * @param size Requested size.
+ *
+ * @return Legal size.
+ */
+static po_size_t po_legal_size( po_size_t size )
+{
+    /* Make size even. */
+    size = po_snor( size );
+
+    /* Make size big enough. */
+    if ( size < PO_MIN_SIZE ) {
+        size = PO_MIN_SIZE;
+    }
+
+    /* Return proper aligment if size if bigger than page size. */
+    return po_align_size( size );
+}
+
+
+/**
+ * Normalize (possibly negative) Postor index. Positive index is
+ * saturated to Postor length, and negative index is normalized.
+ *
+ * -1 means last char in Postor, -2 second to last, etc. Index after
+ * last char can only be expressed by positive indeces. E.g. for
+ * Postor with length of 4 the indeces are:
+ *
+ * Chars:     a  b  c  d  \0
+ * Positive:  0  1  2  3  4
+ * Negative: -4 -3 -2 -1
+ *
+ * @param po  Postor.
+ * @param idx Index to Postor.
+ *
+ * @return Unsigned (positive) index to Postor.
+ */
+static po_size_t po_norm_idx( po_t po, po_pos_t idx )
+{
+    po_size_t pidx;
+
+    if ( idx < 0 ) {
+        pidx = po->used + idx;
+        idx  = po->used + idx;
+    } else {
+        pidx = idx;
+    }
+
+    if ( pidx >= po->used ) {
+        po_assert( 0 ); // GCOV_EXCL_LINE
+        return po->used - 1; // GCOV_EXCL_LINE
+    } else if ( idx < 0 ) {
+        po_assert( 0 ); // GCOV_EXCL_LINE
+        return 0;
+    } else {
+        return pidx;
+    }
+}
+
+
+/**
+ * Resize Postor to requested size.
+ *
+ * Storage is kept unchanged on allocation failure.
+ *
+ * @param po       Postor reference.
+ * @param new_size Requested size (legalized).
+ */
+static void po_resize_to( po_t po, po_size_t new_size )
+{
+    pm_stat_add( resizes, 1 );
+    pm_stat_add( resize_bytes, pm_unit2byte( new_size ) );
+    pm_stat_max( peak_size, new_size );
+
+    po_rebase( po );
+
+    if ( pm_shared( po ) && __atomic_load_n( po->ext->shared, __ATOMIC_ACQUIRE ) == 1 ) {
+        /* Last holder owns the storage. */
+        po_share_release( po, NULL );
+    }
+
+    if ( po_local( po ) || pm_shared( po ) ) {
+
+        /* Spill local storage, or copy shared storage, to heap. */
+        po_d* data = po_store_alloc( po, new_size );
+        if ( data == NULL ) {
+            return; // GCOV_EXCL_LINE
+        }
+        memcpy( data, po->data, po_used_size( po ) );
+        pm_stat_add( copy_bytes, po_used_size( po ) );
+        if ( pm_shared( po ) ) {
+            po_share_release( po, po->data );
+        }
+        po->data = data;
+
+    } else {
+
+        po_d* data = po_store_resize( po, po->data, pm_size( po ), new_size );
+        if ( data == NULL ) {
+            return; // GCOV_EXCL_LINE
+        }
+        po->data = data;
+    }
+
+    po_set_size_and_local( po, new_size, 0 );
+}
+
+
+/**
+ * Prefetch pointee of item at index, if item is within range and not
+ * NULL.
+ *
+ * @param data Items.
+ * @param idx  Item index.
+ * @param end  End index.
+ */
+static inline void po_prefetch( po_d* data, po_size_t idx, po_size_t end )
+{
+    if ( idx < end && data[ idx ] ) {
+        __builtin_prefetch( data[ idx ], 0, 3 );
+    }
+}
+
+
+/**
+ * Move data to the start of allocation, i.e. remove headroom.
+ *
+ * @param po Postor.
+ */
+static void po_rebase( po_t po )
+{
+    po_size_t head = pm_head( po );
+
+    if ( head > 0 ) {
+        memmove( po->data - head, po->data, po_used_size( po ) );
+        pm_stat_add( copy_bytes, po_used_size( po ) );
+        po->data -= head;
+        po->ext->head = 0;
+        po_set_size( po, po->ext->total );
+    }
+}
+
+
+/**
+ * Make headroom (free slots before data) for po_push_front().
+ *
+ * Headroom is half of usage (plus some), and at least one slot is
+ * left free after the items (see po_set_head()). Data is moved within
+ * the allocation if it fits, and otherwise Postor is resized.
+ *
+ * @param po Postor (with extension).
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+static int po_make_headroom( po_t po )
+{
+    po_size_t head;
+    po_size_t total;
+    po_size_t need;
+
+    po_rebase( po );
+
+    head = ( po->used >> 1 ) + 4;
+    total = pm_size( po );
+    need = po->used + head + 1;
+
+    if ( total < need && pm_mapped( po ) ) {
+        /* Mapped storage grows without copy. */
+        po_d* base;
+        total = po_incr_size( po, need );
+        base = po_store_resize( po, po->data, pm_size( po ), total );
+        if ( base == NULL ) {
+            return po_false; // GCOV_EXCL_LINE
+        }
+        po->data = base;
+        memmove( po->data + head, po->data, po_used_size( po ) );
+        pm_stat_add( copy_bytes, po_used_size( po ) );
+        po->data += head;
+    } else if ( total < need ) {
+        po_d* base;
+        total = po_incr_size( po, need );
+        base = po_store_alloc( po, total );
+        if ( base == NULL ) {
+            return po_false;
+        }
+        memcpy( base + head, po->data, po_used_size( po ) );
+        pm_stat_add( copy_bytes, po_used_size( po ) );
+        if ( po->data && !po_local( po ) ) {
+            po_store_free( po, po->data );
+        }
+        po->data = base + head;
+        po_set_local( po, 0 );
+    } else {
+        memmove( po->data + head, po->data, po_used_size( po ) );
+        pm_stat_add( copy_bytes, po_used_size( po ) );
+        po->data += head;
+    }
+
+    po->ext->total = total;
+    po_set_head( po, head );
+
+    return po_true;
+}
+
+
+/**
+ * Return true if there is no space after the items.
+ *
+ * @param po Postor (with extension).
+ *
+ * @return 1 if full.
+ */
+static int po_tail_full( po_t po )
+{
+    if ( po->ext->head > 0 ) {
+        return po->used >= po->ext->total - po->ext->head;
+    } else {
+        return po->used >= pm_size( po );
+    }
+}
+
+
+/**
+ * Set headroom and update size accordingly.
+ *
+ * Size is the even part of the allocation after headroom. Head is
+ * moved only when there is space after the items (see:
+ * po_tail_full()), hence size is not below usage.
+ *
+ * @param po   Postor (with extension).
+ * @param head Headroom.
+ */
+static void po_set_head( po_t po, po_size_t head )
+{
+    po->ext->head = head;
+    po_set_size( po, ( po->ext->total - head ) & po_lbmc );
+    po_assert( pm_size( po ) >= po->used );
+}
+
+
+/**
+ * Resize storage allocation.
+ *
+ * Memory after "old_size" is cleared. Heap storage is reallocated.
+ * Mapped storage grows within mapped range, or with mremap() beyond
+ * it. Pages released by shrinking are returned to the system.
+ *
+ * @param po       Postor.
+ * @param base     Allocation (or NULL).
+ * @param old_size Current size.
+ * @param new_size Requested size.
+ *
+ * @return Allocation (or NULL on failure, when "base" is kept).
+ */
+static po_d* po_store_resize( po_t po, po_d* base, po_size_t old_size, po_size_t new_size )
+{
+#ifdef PO_USE_MMAP
+    if ( pm_mapped( po ) ) {
+
+        po_size_t bytes = pm_unit2byte( new_size );
+
+        if ( new_size < old_size ) {
+            /* Memory after size is kept cleared, i.e. it is not
+             * cleared at growth, and pages are not touched. */
+            po_size_t keep = po_map_granule( po, bytes );
+            po_size_t used = po_map_granule( po, pm_unit2byte( old_size ) );
+            memset( &base[ new_size ], 0, ( keep < used ? keep : used ) - bytes );
+            if ( keep < used && madvise( (char*)base + keep, used - keep, MADV_DONTNEED ) != 0 ) {
+                memset( (char*)base + keep, 0, used - keep ); // GCOV_EXCL_LINE
+            }
+        }
+
+        if ( bytes > po->ext->mapped ) {
+            po_size_t old_mapped = po->ext->mapped;
+            po_size_t mapped = old_mapped;
+            po_d*     mem;
+
+            while ( mapped < bytes ) {
+                mapped *= 2;
+            }
+
+            mem = mremap( base, old_mapped, mapped, MREMAP_MAYMOVE );
+            if ( mem != MAP_FAILED ) {
+                if ( po->ext->map & PO_MAP_THP ) {
+                    madvise( mem, mapped, MADV_HUGEPAGE );
+                }
+                po->ext->mapped = mapped;
+            } else {
+                /* Huge page mappings might not be remappable: copy. */
+                mem = po_map_create( po, mapped );
+                if ( mem == NULL ) {
+                    // GCOV_EXCL_START
+                    po->ext->mapped = old_mapped;
+                    return NULL;
+                    // GCOV_EXCL_STOP
+                }
+                memcpy( mem, base, pm_unit2byte( old_size ) );
+                pm_stat_add( copy_bytes, pm_unit2byte( old_size ) );
+                munmap( base, old_mapped );
+            }
+            base = mem;
+        }
+
+        return base;
+    }
+#endif
+
+#ifdef POSTOR_USE_POOL
+    if ( old_size <= PO_POOL_MAX || new_size <= PO_POOL_MAX ) {
+        /* Pooled blocks are not reallocated: move. */
+        po_d* mem;
+        if ( new_size <= PO_POOL_MAX ) {
+            mem = po_pool_alloc( new_size );
+        } else {
+            mem = po_malloc_raw( pm_unit2byte( new_size ) );
+        }
+        if ( mem == NULL ) {
+            return NULL; // GCOV_EXCL_LINE
+        }
+        if ( base ) {
+            memcpy( mem, base, pm_unit2byte( old_size < new_size ? old_size : new_size ) );
+            pm_stat_add( copy_bytes, pm_unit2byte( old_size < new_size ? old_size : new_size ) );
+            po_pool_free( base, old_size );
+        }
+        base = mem;
+    } else {
+        base = po_realloc( base, pm_unit2byte( new_size ) );
+    }
+#else
+    base = po_realloc( base, pm_unit2byte( new_size ) );
+#endif
+
+    if ( base == NULL ) {
+        return NULL; // GCOV_EXCL_LINE
+    }
+
+    if ( new_size > old_size && pm_clear( po ) ) {
+        /* Clear newly allocated memory. */
+        memset( &( base[ old_size ] ), 0, ( new_size - old_size ) * sizeof( po_d ) );
+        pm_stat_add( clear_bytes, ( new_size - old_size ) * sizeof( po_d ) );
+    }
+
+    return base;
+}
+
+
+/**
+ * Free storage allocation.
+ *
+ * @param po   Postor.
+ * @param base Allocation.
+ */
+static void po_store_free( po_t po, po_d* base )
+{
+#ifdef PO_USE_MMAP
+    if ( pm_mapped( po ) ) {
+        munmap( base, po->ext->mapped );
+        po->ext->mapped = 0;
+        return;
+    }
+#endif
+#ifdef POSTOR_USE_POOL
+    po_pool_free( base, pm_head( po ) ? po->ext->total : pm_size( po ) );
+#else
+    (void)po;
+    po_free( base );
+#endif
+}
+
+
+/**
+ * Allocate storage for "size" items.
+ *
+ * Storage is cleared, unless clearing is disabled.
+ *
+ * @param po   Postor.
+ * @param size Size.
+ *
+ * @return Allocation (or NULL).
+ */
+static po_d* po_store_alloc( po_t po, po_size_t size )
+{
+#ifdef POSTOR_USE_POOL
+    if ( size <= PO_POOL_MAX ) {
+        po_d* base = po_pool_alloc( size );
+        if ( base && pm_clear( po ) ) {
+            memset( base, 0, pm_unit2byte( size ) );
+            pm_stat_add( clear_bytes, pm_unit2byte( size ) );
+        }
+        return base;
+    }
+#endif
+    return pm_alloc( po, pm_unit2byte( size ) );
+}
+
+
+#ifdef POSTOR_USE_POOL
+
+/*
+ * Pool of storage blocks.
+ *
+ * Blocks are pooled in power of two size classes, up to
+ * PO_POOL_MAX. Allocation is taken from class that fits the size, and
+ * block is returned to the class that the (current) size fits, i.e. a
+ * block is always at least as big as its class. Hence also blocks from
+ * other sources (e.g. po_new_pages()) can be returned to pool.
+ *
+ * Each thread has a cache of blocks, and caches are balanced through
+ * global depot, in batches of half cache.
+ */
+
+/**
+ * Move blocks from list to another.
+ *
+ * @param to    Target list.
+ * @param from  Source list.
+ * @param c     Size class.
+ * @param count Max number of blocks.
+ */
+static void po_pool_move( po_pool_list_s* to, po_pool_list_s* from, int c, po_size_t count )
+{
+    po_pool_node_s* node;
+
+    while ( count-- > 0 && from->head[ c ] ) {
+        node = from->head[ c ];
+        from->head[ c ] = node->next;
+        from->count[ c ]--;
+        node->next = to->head[ c ];
+        to->head[ c ] = node;
+        to->count[ c ]++;
+    }
+}
+
+
+/**
+ * Release blocks from list to system.
+ *
+ * @param list List.
+ * @param c    Size class.
+ * @param keep Blocks to keep.
+ */
+static void po_pool_release( po_pool_list_s* list, int c, po_size_t keep )
+{
+    po_pool_node_s* node;
+
+    while ( list->count[ c ] > keep ) {
+        node = list->head[ c ];
+        list->head[ c ] = node->next;
+        list->count[ c ]--;
+        po_free( node );
+    }
+}
+
+
+/**
+ * Return thread cache blocks to depot at thread exit.
+ *
+ * @param arg Thread cache.
+ */
+static void po_pool_exit( void* arg )
+{
+    po_pool_list_s* cache = arg;
+
+    pthread_mutex_lock( &po_pool_lock );
+    for ( int c = 0; c <= PO_POOL_SHIFT; c++ ) {
+        po_pool_move( &po_pool_depot, cache, c, cache->count[ c ] );
+        po_pool_release( &po_pool_depot, c, PO_POOL_DEPOT );
+    }
+    /* Slab entries are not released, since slabs are kept. */
+    po_pool_move( &po_pool_depot, cache, PO_POOL_SLAB, cache->count[ PO_POOL_SLAB ] );
+    pthread_mutex_unlock( &po_pool_lock );
+}
+
+
+/** Create thread exit key. */
+static void po_pool_init( void )
+{
+    pthread_key_create( &po_pool_key, po_pool_exit );
+}
+
+
+/**
+ * Return thread cache (registered for thread exit).
+ *
+ * @return Thread cache.
+ */
+static po_pool_list_s* po_pool_thread( void )
+{
+    if ( !po_pool_registered ) {
+        pthread_once( &po_pool_once, po_pool_init );
+        pthread_setspecific( po_pool_key, &po_pool_cache );
+        po_pool_registered = po_true;
+    }
+
+    return &po_pool_cache;
+}
+
+
+/**
+ * Allocate block from pool (without clearing).
+ *
+ * @param size Size (max PO_POOL_MAX).
+ *
+ * @return Block.
+ */
+static po_d* po_pool_alloc( po_size_t size )
+{
+    po_pool_list_s* cache = po_pool_thread();
+    po_pool_node_s* node;
+    int             c;
+
+    /* Smallest class that fits. */
+    c = ( size > 1 ) ? 64 - __builtin_clzll( size - 1 ) : 0;
+
+    if ( cache->head[ c ] == NULL ) {
+        pthread_mutex_lock( &po_pool_lock );
+        po_pool_move( cache, &po_pool_depot, c, PO_POOL_CACHE / 2 );
+        pthread_mutex_unlock( &po_pool_lock );
+    }
+
+    node = cache->head[ c ];
+    if ( node == NULL ) {
+        return po_malloc_raw( pm_unit2byte( (po_size_t)1 << c ) );
+    }
+
+    cache->head[ c ] = node->next;
+    cache->count[ c ]--;
+
+    return (po_d*)node;
+}
+
+
+/**
+ * Free block to pool.
+ *
+ * Block is freed to system, if it is bigger than PO_POOL_MAX.
+ *
+ * @param base Block.
+ * @param size Size of block.
+ */
+static void po_pool_free( po_d* base, po_size_t size )
+{
+    po_pool_list_s* cache;
+    po_pool_node_s* node = (po_pool_node_s*)base;
+    int             c;
+
+    if ( size > PO_POOL_MAX || size == 0 ) {
+        po_free( base );
+        return;
+    }
+
+    cache = po_pool_thread();
+
+    /* Largest class that block fits. */
+    c = 63 - __builtin_clzll( size );
+
+    node->next = cache->head[ c ];
+    cache->head[ c ] = node;
+    cache->count[ c ]++;
+
+    if ( cache->count[ c ] > PO_POOL_CACHE ) {
+        pthread_mutex_lock( &po_pool_lock );
+        po_pool_move( &po_pool_depot, cache, c, PO_POOL_CACHE / 2 );
+        po_pool_release( &po_pool_depot, c, PO_POOL_DEPOT );
+        pthread_mutex_unlock( &po_pool_lock );
+    }
+}
+
+
+/**
+ * Allocate descriptor from thread's slab.
+ *
+ * Slabs of PO_SLAB_COUNT descriptors are allocated when thread cache
+ * and depot are empty. Slabs are never released to system, since
+ * descriptor ownership is checked against slab registry without
+ * lock.
+ *
+ * @return Descriptor (cleared) or NULL.
+ */
+static po_t po_slab_alloc( void )
+{
+    po_pool_list_s* cache = po_pool_thread();
+    po_pool_node_s* node;
+    po_s*           slab;
+
+    if ( cache->head[ PO_POOL_SLAB ] == NULL ) {
+        pthread_mutex_lock( &po_pool_lock );
+        po_pool_move( cache, &po_pool_depot, PO_POOL_SLAB, PO_SLAB_COUNT );
+        pthread_mutex_unlock( &po_pool_lock );
+    }
+
+    if ( cache->head[ PO_POOL_SLAB ] == NULL ) {
+        slab = po_slab_create();
+        if ( slab == NULL ) {
+            return NULL; // GCOV_EXCL_LINE
+        }
+        for ( po_size_t i = 0; i < PO_SLAB_COUNT; i++ ) {
+            node = (po_pool_node_s*)&slab[ i ];
+            node->next = cache->head[ PO_POOL_SLAB ];
+            cache->head[ PO_POOL_SLAB ] = node;
+        }
+        cache->count[ PO_POOL_SLAB ] += PO_SLAB_COUNT;
+    }
+
+    node = cache->head[ PO_POOL_SLAB ];
+    cache->head[ PO_POOL_SLAB ] = node->next;
+    cache->count[ PO_POOL_SLAB ]--;
+
+    memset( node, 0, sizeof( po_s ) );
+
+    return (po_t)node;
+}
+
+
+/**
+ * Free descriptor to thread's slab cache.
+ *
+ * Excess entries are moved to depot.
+ *
+ * @param po Descriptor (from po_slab_alloc()).
+ */
+static void po_slab_free( po_t po )
+{
+    po_pool_list_s* cache = po_pool_thread();
+    po_pool_node_s* node;
+
+    node = (po_pool_node_s*)po;
+    node->next = cache->head[ PO_POOL_SLAB ];
+    cache->head[ PO_POOL_SLAB ] = node;
+    cache->count[ PO_POOL_SLAB ]++;
+
+    if ( cache->count[ PO_POOL_SLAB ] > 2 * PO_SLAB_COUNT ) {
+        pthread_mutex_lock( &po_pool_lock );
+        po_pool_move( &po_pool_depot, cache, PO_POOL_SLAB, PO_SLAB_COUNT );
+        pthread_mutex_unlock( &po_pool_lock );
+    }
+}
+
+
+/**
+ * Allocate slab (aligned to PO_SLAB_BYTES) and register it.
+ *
+ * Registry is grown to double size, when it becomes half full.
+ *
+ * @return Slab or NULL.
+ */
+static po_s* po_slab_create( void )
+{
+    po_slab_set_s* set;
+    po_slab_set_s* grown;
+    void*          slab;
+    size_t         slots;
+
+    if ( posix_memalign( &slab, PO_SLAB_BYTES, PO_SLAB_BYTES ) ) {
+        return NULL; // GCOV_EXCL_LINE
+    }
+
+    pthread_mutex_lock( &po_pool_lock );
+
+    set = po_slab_set;
+    if ( set == NULL || 2 * ( set->count + 1 ) > set->mask + 1 ) {
+        slots = set ? 2 * ( set->mask + 1 ) : 64;
+        grown = po_malloc( sizeof( po_slab_set_s ) + slots * sizeof( uintptr_t ) );
+        if ( grown == NULL ) {
+            // GCOV_EXCL_START
+            pthread_mutex_unlock( &po_pool_lock );
+            free( slab );
+            return NULL;
+            // GCOV_EXCL_STOP
+        }
+        grown->prev = set;
+        grown->mask = slots - 1;
+        grown->count = 0;
+        for ( size_t i = 0; set && i <= set->mask; i++ ) {
+            if ( set->slot[ i ] ) {
+                po_slab_insert( grown, set->slot[ i ] );
+            }
+        }
+        __atomic_store_n( &po_slab_set, grown, __ATOMIC_RELEASE );
+        set = grown;
+    }
+    po_slab_insert( set, (uintptr_t)slab );
+
+    pthread_mutex_unlock( &po_pool_lock );
+
+    return slab;
+}
+
+
+/**
+ * Insert slab base to registry set (with free slots).
+ *
+ * @param set  Registry set.
+ * @param base Slab base.
+ */
+static void po_slab_insert( po_slab_set_s* set, uintptr_t base )
+{
+    size_t i;
+
+    i = (size_t)( ( base / PO_SLAB_BYTES ) * 0x9E3779B97F4A7C15ULL >> 32 ) & set->mask;
+    while ( set->slot[ i ] ) {
+        i = ( i + 1 ) & set->mask;
+    }
+    __atomic_store_n( &set->slot[ i ], base, __ATOMIC_RELEASE );
+    set->count++;
+}
+
+
+/**
+ * Check if descriptor is from slab.
+ *
+ * Only descriptor address is used, i.e. descriptor memory is not
+ * accessed.
+ *
+ * @param po Descriptor.
+ *
+ * @return 1 if from slab.
+ */
+static int po_slab_owns( po_t po )
+{
+    po_slab_set_s* set;
+    uintptr_t      base;
+    uintptr_t      slot;
+    size_t         i;
+
+    set = __atomic_load_n( &po_slab_set, __ATOMIC_ACQUIRE );
+    if ( set == NULL ) {
+        return 0;
+    }
+
+    base = (uintptr_t)po & ~(uintptr_t)( PO_SLAB_BYTES - 1 );
+    i = (size_t)( ( base / PO_SLAB_BYTES ) * 0x9E3779B97F4A7C15ULL >> 32 ) & set->mask;
+    while ( ( slot = __atomic_load_n( &set->slot[ i ], __ATOMIC_ACQUIRE ) ) ) {
+        if ( slot == base ) {
+            return 1;
+        }
+        i = ( i + 1 ) & set->mask;
+    }
+
+    return 0;
+}
+
+#endif
+
+
+#ifdef PO_USE_MMAP
+
+/**
+ * Round bytes up to mapping granule (page or huge page).
+ *
+ * @param po    Postor (with extension).
+ * @param bytes Byte count.
+ *
+ * @return Rounded byte count.
+ */
+static po_size_t po_map_granule( po_t po, po_size_t bytes )
+{
+    po_size_t page;
+
+    if ( po->ext->map & PO_MAP_HUGETLB ) {
+        page = PO_HUGE_PAGE;
+    } else {
+        page = sysconf( _SC_PAGESIZE );
+    }
+
+    return ( ( bytes + page - 1 ) / page ) * page;
+}
+
+
+/**
+ * Create mapping for Postor.
+ *
+ * Explicit huge pages fall back to normal pages, if huge pages are
+ * not available.
+ *
+ * @param po    Postor (with extension).
+ * @param bytes Mapping size.
+ *
+ * @return Mapping (or NULL).
+ */
+static po_d* po_map_create( po_t po, po_size_t bytes )
+{
+    po_d* base = MAP_FAILED;
+    int   flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+    if ( po->ext->map & PO_MAP_HUGETLB ) {
+        /* Huge pages are reserved, since missing huge page on touch
+         * would be SIGBUS. */
+        po->ext->mapped = po_map_granule( po, bytes );
+        base = mmap( NULL, po->ext->mapped, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0 );
+        if ( base == MAP_FAILED ) {
+            po->ext->map &= ~PO_MAP_HUGETLB;
+        }
+    }
+
+    if ( base == MAP_FAILED ) {
+        po->ext->mapped = po_map_granule( po, bytes );
+        base = mmap( NULL,
+                     po->ext->mapped,
+                     PROT_READ | PROT_WRITE,
+                     flags | MAP_NORESERVE,
+                     -1,
+                     0 );
+    }
+
+    if ( base == MAP_FAILED ) {
+        po->ext->mapped = 0; // GCOV_EXCL_LINE
+        return NULL;         // GCOV_EXCL_LINE
+    }
+
+    if ( po->ext->map & PO_MAP_THP ) {
+        madvise( base, po->ext->mapped, MADV_HUGEPAGE );
+    }
+
+    return base;
+}
+
+#endif
+
+
+/**
+ * Chain new block to arena Postor.
+ *
+ * Current block is retired, and new block has same size as current,
+ * or more if "units" do not fit.
+ *
  * @param po    Postor.
- * @param size  Size.
+ * @param units Allocation that must fit.
+ *
+ * @return 1 if block was chained.
+ */
+static int po_arena_grow( po_t po, po_size_t units )
+{
+    po_size_t         page;
+    po_size_t         size;
+    po_d*             mem;
+    po_arena_block_s* block;
+
+    if ( !po->ext || !po->ext->arena ) {
+        return po_false;
+    }
+
+    if ( po->ext->block_used >= po->ext->block_size ) {
+        size = po->ext->block_size ? 2 * po->ext->block_size : 8;
+        block = po_realloc( po->ext->blocks, size * sizeof( po_arena_block_s ) );
+        if ( block == NULL ) {
+            return po_false; // GCOV_EXCL_LINE
+        }
+        po->ext->blocks = block;
+        po->ext->block_size = size;
+    }
+
+    page = pm_byte2unit( po_alloc_pages( 0, NULL ) );
+    size = pm_size( po );
+    if ( size < units ) {
+        size = units;
+    }
+
+    size = pm_byte2unit( po_alloc_pages( ( size + page - 1 ) / page, &mem ) );
+    if ( size == 0 ) {
+        return po_false; // GCOV_EXCL_LINE
+    }
+
+    block = &po->ext->blocks[ po->ext->block_used++ ];
+    block->data = po->data;
+    block->size = pm_size( po );
+    block->used = po->used;
+
+    po->data = mem;
+    po->used = 0;
+    po_set_size( po, size );
+
+    return po_true;
+}
+
+
+/**
+ * Return true if Postor storage can be shrunk.
+ *
+ * Local storage and arena blocks are not shrunk.
+ *
+ * @param po Postor.
+ *
+ * @return 1 if shrinkable.
+ */
+static int po_shrinkable( po_t po )
+{
+    return ( po->data && !po_local( po ) && !( po->ext && po->ext->arena ) );
+}
+
+
+/**
+ * Shrink Postor automatically.
+ *
+ * Reservation is halved while usage is below quarter of it, hence
+ * usage must double before Postor grows again (hysteresis).
+ * Reservation is not shrunk below PO_DEFAULT_SIZE.
+ *
+ * @param po Postor (with extension).
+ */
+static void po_shrink_auto( po_t po )
+{
+    /* Headroom is included, since it is released by resize. */
+    po_size_t size = pm_head( po ) ? po->ext->total : pm_size( po );
+
+    if ( po->used >= ( size >> 2 ) || !po_shrinkable( po ) ) {
+        return;
+    }
+
+    while ( po->used < ( size >> 2 ) && ( size >> 1 ) >= PO_DEFAULT_SIZE ) {
+        size >>= 1;
+    }
+
+    size = po_legal_size( size );
+    if ( size < pm_size( po ) || pm_head( po ) > 0 ) {
+        po_resize_to( po, size );
+    }
+}
+
+
+/**
+ * Make sure that Postor fits "new_used" items.
+ *
+ * Postor is resized (once) according to growth policy.
+ *
+ * @param po       Postor.
+ * @param new_used Required usage count.
+ */
+static void po_reserve_for( po_t po, po_size_t new_used )
+{
+    if ( new_used > pm_size( po ) ) {
+        po_resize_to( po, po_incr_size( po, new_used ) );
+    }
+    pm_stat_max( peak_used, new_used );
+}
+
+
+/**
+ * Compact Postor by keeping items for which predicate equals "keep".
+ *
+ * @param po    Postor.
+ * @param pred  Predicate function.
+ * @param state State for predicate.
+ * @param keep  Predicate result (boolean) for kept items.
+ *
+ * @return Number of items deleted.
+ */
+static po_size_t po_compact( po_t po, po_pred_fn_p pred, po_d state, int keep )
+{
+    po_size_t wr = 0;
+    po_size_t count;
+
+    pm_own( po );
+
+    for ( po_size_t rd = 0; rd < po->used; rd++ ) {
+        po_d item = pm_nth( po, rd );
+        if ( ( pred( item, state ) != 0 ) == keep ) {
+            pm_nth( po, wr++ ) = item;
+        }
+    }
+
+    count = po->used - wr;
+    po->used = wr;
+    if ( count > 0 && pm_empty( po ) ) {
+        pm_first( po ) = NULL;
+    }
+    if ( count > 0 ) {
+        po_index_sync( po );
+    }
+    if ( pm_shrink( po ) ) {
+        po_shrink_auto( po );
+    }
+
+    return count;
+}
+
+
+/**
+ * Binary search for lower or upper bound of "ref".
+ *
+ * @param po      Postor (sorted).
+ * @param compare Compare function (for item references).
+ * @param ref     Reference item.
+ * @param upper   Upper bound (else lower bound).
+ *
+ * @return Bound index.
+ */
+static po_size_t po_bound( po_t po, po_compare_fn_p compare, po_d ref, int upper )
+{
+    po_size_t lo = 0;
+    po_size_t n = po->used;
+
+    while ( n > 0 ) {
+        po_size_t half = n >> 1;
+        int       cmp = compare( &( pm_nth( po, lo + half ) ), &ref );
+        if ( cmp < 0 || ( upper && cmp == 0 ) ) {
+            lo += half + 1;
+            n -= half + 1;
+        } else {
+            n = half;
+        }
+    }
+
+    return lo;
+}
+
+
+/**
+ * Return thread count for parallel operation.
+ *
+ * @param threads Requested count (0 for CPU count).
+ * @param n       Item count.
+ *
+ * @return Thread count.
+ */
+static po_size_t po_thread_count( po_size_t threads, po_size_t n )
+{
+    if ( threads == 0 ) {
+        long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        threads = ( cpus > 0 ) ? (po_size_t)cpus : 1;
+    }
+
+    if ( threads > n / PO_PARALLEL_MIN ) {
+        threads = n / PO_PARALLEL_MIN;
+    }
+
+    if ( threads > PO_MAX_THREADS ) {
+        threads = PO_MAX_THREADS;
+    }
+
+    return threads;
+}
+
+
+/**
+ * Run tasks in parallel.
+ *
+ * First task is run in the calling thread. Task is run in the calling
+ * thread also if thread creation fails.
+ *
+ * @param fn        Task function.
+ * @param tasks     Task array.
+ * @param task_size Task size in bytes.
+ * @param count     Task count.
+ */
+static void po_run_tasks( void* ( *fn )( void* ), void* tasks, size_t task_size, po_size_t count )
+{
+    pthread_t th[ 2 * PO_MAX_THREADS ];
+    char      started[ 2 * PO_MAX_THREADS ];
+
+    for ( po_size_t t = 1; t < count; t++ ) {
+        void* task = (char*)tasks + t * task_size;
+        started[ t ] = ( pthread_create( &th[ t ], NULL, fn, task ) == 0 );
+        if ( !started[ t ] ) {
+            fn( task ); // GCOV_EXCL_LINE
+        }
+    }
+
+    fn( tasks );
+
+    for ( po_size_t t = 1; t < count; t++ ) {
+        if ( started[ t ] ) {
+            pthread_join( th[ t ], NULL );
+        }
+    }
+}
+
+
+/**
+ * Sort chunk task.
+ *
+ * @param arg Task (po_sort_task_s).
+ *
+ * @return NULL.
+ */
+static void* po_sort_task( void* arg )
+{
+    po_sort_task_s* task = arg;
+
+    po_sort_cb( task->src + task->a, task->e - task->a, task->compare );
+
+    return NULL;
+}
+
+
+/**
+ * Find split of output position "k" in merge of runs "a" and "b".
+ *
+ * @param a       First run.
+ * @param na      First run length.
+ * @param b       Second run.
+ * @param nb      Second run length.
+ * @param k       Output position.
+ * @param compare Compare function.
+ *
+ * @return Number of items from first run in output before "k".
+ */
+static po_size_t po_merge_split( po_d*           a,
+                                 po_size_t       na,
+                                 po_d*           b,
+                                 po_size_t       nb,
+                                 po_size_t       k,
+                                 po_compare_fn_p compare )
+{
+    po_size_t lo = ( k > nb ) ? k - nb : 0;
+    po_size_t hi = ( k < na ) ? k : na;
+
+    while ( lo < hi ) {
+        po_size_t i = ( lo + hi ) / 2;
+        po_size_t j = k - i;
+        /* Equal items are taken from first run first. */
+        if ( j > 0 && compare( &a[ i ], &b[ j - 1 ] ) <= 0 ) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+
+    return lo;
+}
+
+
+/**
+ * Merge (part of) two runs task.
+ *
+ * @param arg Task (po_sort_task_s).
+ *
+ * @return NULL.
+ */
+static void* po_merge_task( void* arg )
+{
+    po_sort_task_s* task = arg;
+    po_d*           a = task->src + task->a;
+    po_d*           b = task->src + task->m;
+    po_size_t       na = task->m - task->a;
+    po_size_t       nb = task->e - task->m;
+    po_d*           out = task->dst + task->a + task->k0;
+    po_size_t       i, j, i1, j1;
+
+    i = po_merge_split( a, na, b, nb, task->k0, task->compare );
+    j = task->k0 - i;
+    i1 = po_merge_split( a, na, b, nb, task->k1, task->compare );
+    j1 = task->k1 - i1;
+
+    while ( i < i1 && j < j1 ) {
+        if ( task->compare( &b[ j ], &a[ i ] ) < 0 ) {
+            *out++ = b[ j++ ];
+        } else {
+            *out++ = a[ i++ ];
+        }
+    }
+    memcpy( out, &a[ i ], ( i1 - i ) * po_unit_size );
+    out += i1 - i;
+    memcpy( out, &b[ j ], ( j1 - j ) * po_unit_size );
+
+    return NULL;
+}
+
+
+/**
+ * Find chunk task.
+ *
+ * Scanning is stopped if a match at lower index is found by another
+ * task.
+ *
+ * @param arg Task (po_find_task_s).
+ *
+ * @return NULL.
+ */
+static void* po_find_task( void* arg )
+{
+    po_find_task_s* task = arg;
+    po_size_t       best;
+
+    for ( po_size_t i = task->beg; i < task->end; i++ ) {
+        if ( ( i & 0x3FF ) == 0 && __atomic_load_n( task->best, __ATOMIC_RELAXED ) < task->beg ) {
+            return NULL;
+        }
+        if ( task->compare( pm_nth( task->po, i ), task->ref ) ) {
+            best = __atomic_load_n( task->best, __ATOMIC_RELAXED );
+            while ( i < best
+                    && !__atomic_compare_exchange_n(
+                        task->best, &best, i, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+                ;
+            return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Return segment of Concurrent Postor, allocate it if missing.
+ *
+ * Racing allocations are resolved with CAS, i.e. the loser releases
+ * its allocation.
+ *
+ * @param cc Concurrent Postor.
+ * @param k  Segment number.
+ *
+ * @return Segment (or NULL on allocation failure).
  */
-static void po_set_size( po_t po, po_size_t size )
+static po_d* po_cc_segment( po_cc_t cc, po_size_t k )
 {
-    int local;
+    po_d* seg;
+    po_d* mem;
 
-    local = po_get_local( po );
-    po->size = size;
-    po_set_local( po, local );
+    seg = __atomic_load_n( &cc->seg[ k ], __ATOMIC_ACQUIRE );
+    if ( seg ) {
+        return seg;
+    }
+
+    mem = po_malloc( pm_unit2byte( cc->base << k ) );
+    if ( mem == NULL ) {
+        return NULL; // GCOV_EXCL_LINE
+    }
+
+    if ( __atomic_compare_exchange_n(
+             &cc->seg[ k ], &seg, mem, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+        return mem;
+    } else {
+        po_free( mem );
+        return seg;
+    }
 }
 
 
-/** 
- * Set size and local for Postor.
- * 
- * @param po     Postor.
- * @param size   Size.
- * @param local  Local info.
+/* ------------------------------------------------------------
+ * Hash index:
  */
-static void po_set_size_and_local( po_t po, po_size_t size, int local )
+
+
+/**
+ * Return hash for item.
+ *
+ * @param index Index.
+ * @param item  Item.
+ *
+ * @return Hash.
+ */
+static inline po_size_t po_index_hash( po_index_s* index, po_d item )
 {
-    po->size = size;
-    po_set_local( po, local );
+    uint64_t h;
+
+    if ( index->hash ) {
+        h = index->hash( item );
+    } else {
+        h = (uintptr_t)item;
+    }
+
+    /* Finalize (mix) for good distribution in all bits. */
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+
+    return h;
 }
 
 
 /**
- * Initialize Postor struct to given size and local mode.
+ * Return true if items are equal for index.
  *
- * @param po    Postor.
- * @param size  Size (must be already legal).
- * @param local Local mode.
+ * @param index Index.
+ * @param a     Item.
+ * @param b     Item.
+ *
+ * @return 1 if equal.
  */
-static void po_init( po_t po, po_size_t size, po_d data, int local )
+static inline int po_index_equal( po_index_s* index, po_d a, po_d b )
 {
-    po_set_size_and_local( po, size, local );
-    po->used = 0;
-    po->data = data;
+    if ( index->equal ) {
+        return index->equal( a, b ) != 0;
+    } else {
+        return a == b;
+    }
 }
 
 
 /**
- * Align reservation size for 4k and bigger.
+ * Initial origin for index positions.
  *
- * Small reservations are not effected.
+ * Origin moves by one for each po_push_front() and po_pop_front(),
+ * hence slot values stay non-zero in practice.
+ */
+#define PO_INDEX_ORIGIN ( 1ULL << 62 )
+
+
+/**
+ * Return slot value for position.
  *
- * @param new_size    Size to align, if needed.
+ * @param index Index.
+ * @param pos   Position.
  *
- * @return            Valid size.
+ * @return Slot value.
  */
-static po_size_t po_align_size( po_size_t new_size )
+static inline po_size_t po_index_val( po_index_s* index, po_size_t pos )
 {
-    if ( new_size >= 4096 ) {
-        if ( new_size == 4096 ) {
-            new_size = 4096;
-        } else {
-            new_size = ( ( ( new_size >> 12 ) + 1 ) << 12 );
+    return pos + index->origin;
+}
+
+
+/**
+ * Return position for slot value.
+ *
+ * @param index Index.
+ * @param val   Slot value.
+ *
+ * @return Position.
+ */
+static inline po_size_t po_index_pos( po_index_s* index, po_size_t val )
+{
+    return val - index->origin;
+}
+
+
+/**
+ * (Re)build index for all items.
+ *
+ * Slot count is at least twice the number of items.
+ *
+ * @param po    Postor.
+ * @param slots Minimum slot count.
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+static int po_index_build( po_t po, po_size_t slots )
+{
+    po_index_s* index = po->ext->index;
+    po_size_t   count = 16;
+
+    while ( count < slots || count < 2 * po->used ) {
+        count *= 2;
+    }
+
+    if ( count != index->mask + 1 || index->slots == NULL ) {
+        po_size_t* mem = po_malloc( count * sizeof( po_size_t ) );
+        if ( mem == NULL ) {
+            return po_false;
         }
+        po_free( index->slots );
+        index->slots = mem;
+        index->mask = count - 1;
     }
 
-    return new_size;
+    memset( index->slots, 0, count * sizeof( po_size_t ) );
+    index->origin = PO_INDEX_ORIGIN;
+    for ( po_size_t i = 0; i < po->used; i++ ) {
+        po_index_add( po, i );
+    }
+
+    return po_true;
 }
 
 
 /**
- * Calculate incremented memory reservation size.
+ * Lookup lowest position of item.
  *
- * Reservation size is doubled from the existing value.
+ * @param po   Postor.
+ * @param item Item.
  *
- * @param po Postor.
+ * @return Position (or po->used if not found).
+ */
+static po_size_t po_index_lookup( po_t po, po_d item )
+{
+    po_index_s* index = po->ext->index;
+    po_size_t   found = po->used;
+    po_size_t   i;
+
+    i = po_index_hash( index, item ) & index->mask;
+    while ( index->slots[ i ] ) {
+        po_size_t pos = po_index_pos( index, index->slots[ i ] );
+        if ( pos < found && po_index_equal( index, pm_nth( po, pos ), item ) ) {
+            found = pos;
+        }
+        i = ( i + 1 ) & index->mask;
+    }
+
+    return found;
+}
+
+
+/**
+ * Add item at position to index.
  *
- * @return New size.
+ * Index is grown if load factor exceeds 1/2, and detached if growth
+ * fails.
+ *
+ * @param po  Postor.
+ * @param pos Position.
  */
-static po_size_t po_incr_size( po_t po )
+static void po_index_add( po_t po, po_size_t pos )
 {
-    return po_align_size( pm_size( po ) * 2 );
+    po_index_s* index = po->ext->index;
+    po_size_t   i;
+
+    if ( 2 * po->used > index->mask + 1 ) {
+        /* Build adds also the item at "pos". Stale index is dropped. */
+        if ( !po_index_build( po, 2 * ( index->mask + 1 ) ) ) {
+            po_index_detach( po );
+        }
+        return;
+    }
+
+    i = po_index_hash( index, pm_nth( po, pos ) ) & index->mask;
+    while ( index->slots[ i ] ) {
+        i = ( i + 1 ) & index->mask;
+    }
+    index->slots[ i ] = po_index_val( index, pos );
 }
 
 
 /**
- * Convert size to a legal Postor size.
+ * Return slot of item with (index) position.
  *
- * @param size Requested size.
+ * @param index Index.
+ * @param item  Item.
+ * @param pos   Position in index.
  *
- * @return Legal size.
+ * @return Slot.
  */
-static po_size_t po_legal_size( po_size_t size )
+static po_size_t po_index_slot_of( po_index_s* index, po_d item, po_size_t pos )
 {
-    /* Make size even. */
-    size = po_snor( size );
+    po_size_t i;
 
-    /* Make size big enough. */
-    if ( size < PO_MIN_SIZE ) {
-        size = PO_MIN_SIZE;
+    i = po_index_hash( index, item ) & index->mask;
+    while ( index->slots[ i ] != po_index_val( index, pos ) ) {
+        i = ( i + 1 ) & index->mask;
     }
 
-    /* Return proper aligment if size if bigger than page size. */
-    return po_align_size( size );
+    return i;
 }
 
 
 /**
- * Normalize (possibly negative) Postor index. Positive index is
- * saturated to Postor length, and negative index is normalized.
+ * Return slot of position in index.
  *
- * -1 means last char in Postor, -2 second to last, etc. Index after
- * last char can only be expressed by positive indeces. E.g. for
- * Postor with length of 4 the indeces are:
+ * @param index Index.
+ * @param po    Postor.
+ * @param pos   Position.
  *
- * Chars:     a  b  c  d  \0
- * Positive:  0  1  2  3  4
- * Negative: -4 -3 -2 -1
+ * @return Slot.
+ */
+static po_size_t po_index_slot( po_index_s* index, po_t po, po_size_t pos )
+{
+    return po_index_slot_of( index, pm_nth( po, pos ), pos );
+}
+
+
+/**
+ * Delete position from index.
+ *
+ * Item must still be at position. Following slots are shifted
+ * backwards, i.e. no tombstones are used.
  *
  * @param po  Postor.
- * @param idx Index to Postor.
+ * @param pos Position.
+ */
+static void po_index_del( po_t po, po_size_t pos )
+{
+    po_index_s* index = po->ext->index;
+    po_size_t   i;
+    po_size_t   j;
+
+    i = po_index_slot( index, po, pos );
+    j = i;
+
+    for ( ;; ) {
+        j = ( j + 1 ) & index->mask;
+        if ( index->slots[ j ] == 0 ) {
+            break;
+        }
+        po_size_t home;
+        home = po_index_hash( index, pm_nth( po, po_index_pos( index, index->slots[ j ] ) ) ) & index->mask;
+        /* Move if home slot is not cyclically within (i, j]. */
+        if ( ( ( j - home ) & index->mask ) >= ( ( j - i ) & index->mask ) ) {
+            index->slots[ i ] = index->slots[ j ];
+            i = j;
+        }
+    }
+
+    index->slots[ i ] = 0;
+}
+
+
+/**
+ * Change index position of item, i.e. item is moving in Postor.
  *
- * @return Unsigned (positive) index to Postor.
+ * Item must still be at "from".
+ *
+ * @param po   Postor.
+ * @param from Current position.
+ * @param to   New position.
  */
-static po_size_t po_norm_idx( po_t po, po_pos_t idx )
+static void po_index_move( po_t po, po_size_t from, po_size_t to )
 {
-    po_size_t pidx;
+    po_index_s* index = po->ext->index;
 
-    if ( idx < 0 ) {
-        pidx = po->used + idx;
-        idx  = po->used + idx;
+    index->slots[ po_index_slot( index, po, from ) ] = po_index_val( index, to );
+}
+
+
+/**
+ * Shift index positions at and after "pos" by "delta".
+ *
+ * Data is already moved and usage updated, i.e. item inserted at
+ * "pos" is not yet indexed (delta 1), or item deleted from "pos" is
+ * already removed from index (delta -1).
+ *
+ * Items on the shorter side are updated: positions after "pos"
+ * directly, or positions before "pos" back after shifting all
+ * positions with origin. Hence cost is O(min(pos, used - pos)).
+ * Items are updated in order that keeps positions unique.
+ *
+ * @param po    Postor.
+ * @param pos   First position to shift.
+ * @param delta Shift amount (1 or -1).
+ */
+static void po_index_shift( po_t po, po_size_t pos, int delta )
+{
+    po_index_s* index = po->ext->index;
+    po_size_t   tail = ( delta > 0 ) ? po->used - 1 - pos : po->used - pos;
+    po_size_t   i;
+
+    if ( tail <= pos ) {
+        /* Positions after "pos": item at "p" is now at "p + delta". */
+        for ( po_size_t k = 0; k < tail; k++ ) {
+            po_size_t p = ( delta > 0 ) ? po->used - 2 - k : pos + 1 + k;
+            i = po_index_slot_of( index, pm_nth( po, p + delta ), p );
+            index->slots[ i ] = po_index_val( index, p + delta );
+        }
     } else {
-        pidx = idx;
+        /* Positions before "pos": shift all and restore. */
+        po_index_offset( po, delta );
+        for ( po_size_t k = 0; k < pos; k++ ) {
+            po_size_t p = ( delta > 0 ) ? k : pos - 1 - k;
+            i = po_index_slot_of( index, pm_nth( po, p ), p + delta );
+            index->slots[ i ] = po_index_val( index, p );
+        }
     }
+}
 
-    if ( pidx >= po->used ) {
-        po_assert( 0 ); // GCOV_EXCL_LINE
-        return po->used - 1; // GCOV_EXCL_LINE
-    } else if ( idx < 0 ) {
-        po_assert( 0 ); // GCOV_EXCL_LINE
-        return 0;
-    } else {
-        return pidx;
+
+/**
+ * Shift all index positions by "delta", i.e. items are added to or
+ * removed from front. Slots are not changed.
+ *
+ * @param po    Postor.
+ * @param delta Shift amount (1 or -1).
+ */
+static void po_index_offset( po_t po, int delta )
+{
+    po->ext->index->origin -= delta;
+}
+
+
+/**
+ * Rebuild index (if any) after bulk change. Index is detached if
+ * rebuild fails.
+ *
+ * @param po Postor.
+ */
+static void po_index_sync( po_t po )
+{
+    if ( pm_indexed( po ) && !po_index_build( po, 0 ) ) {
+        po_index_detach( po );
     }
 }
 
 
 /**
- * Resize Postor to requested size.
+ * Remove all index entries (if any), i.e. Postor became empty. Table
+ * size is kept.
  *
- * @param po       Postor reference.
- * @param new_size Requested size (legalized).
+ * @param po Postor.
  */
-static void po_resize_to( po_t po, po_size_t new_size )
+static void po_index_clear( po_t po )
 {
-    if ( po_local( po ) ) {
+    if ( pm_indexed( po ) ) {
+        memset( po->ext->index->slots, 0, ( po->ext->index->mask + 1 ) * sizeof( po_size_t ) );
+        po->ext->index->origin = PO_INDEX_ORIGIN;
+    }
+}
 
-        po->data = po_malloc( pm_unit2byte( new_size ) );
 
-    } else {
+/* ------------------------------------------------------------
+ * Search kernels:
+ */
+
 
-        po_size_t old_size = pm_size( po );
-        po->data = po_realloc( po->data, pm_unit2byte( new_size ) );
+/** @cond postor_none */
+
+static po_size_t po_find_scalar( const po_d* data, po_size_t n, po_d item )
+{
+    for ( po_size_t i = 0; i < n; i++ ) {
+        if ( data[ i ] == item ) {
+            return i;
+        }
+    }
+    return n;
+}
 
-        if ( new_size > old_size ) {
-            /* Clear newly allocated memory. */
-            memset( &( po->data[ old_size ] ),
-                    0,
-                    ( new_size - old_size ) * sizeof( po_d ) );
+static po_size_t po_find_last_scalar( const po_d* data, po_size_t n, po_d item )
+{
+    for ( po_size_t i = n; i > 0; i-- ) {
+        if ( data[ i - 1 ] == item ) {
+            return i - 1;
         }
     }
+    return n;
+}
 
-    po_set_size_and_local( po, new_size, 0 );
+static po_size_t po_count_scalar( const po_d* data, po_size_t n, po_d item )
+{
+    po_size_t cnt = 0;
+    for ( po_size_t i = 0; i < n; i++ ) {
+        cnt += ( data[ i ] == item );
+    }
+    return cnt;
+}
+
+static const po_find_kernel_s po_kernel_scalar = {
+    po_find_scalar, po_find_last_scalar, po_count_scalar
+};
+
+
+#ifdef PO_USE_SIMD
+
+/*
+ * Each vector kernel processes 8 pointers per step. Step mask has
+ * one bit per pointer, with LSB for lowest address. Remaining items
+ * are handled by the scalar kernel.
+ */
+
+#define po_simd_kernels( isa, attr )                                    \
+    attr static po_size_t po_find_##isa( const po_d* data, po_size_t n, po_d item ) \
+    {                                                                   \
+        po_size_t i = 0;                                                \
+        for ( ; i + 8 <= n; i += 8 ) {                                  \
+            unsigned m = po_mask_##isa( data + i, item );               \
+            if ( m ) {                                                  \
+                return i + __builtin_ctz( m );                          \
+            }                                                           \
+        }                                                               \
+        return i + po_find_scalar( data + i, n - i, item );             \
+    }                                                                   \
+    attr static po_size_t po_find_last_##isa( const po_d* data, po_size_t n, po_d item ) \
+    {                                                                   \
+        po_size_t i = n & ~7ULL;                                        \
+        po_size_t r = po_find_last_scalar( data + i, n - i, item );     \
+        if ( r < n - i ) {                                              \
+            return i + r;                                               \
+        }                                                               \
+        while ( i > 0 ) {                                               \
+            i -= 8;                                                     \
+            unsigned m = po_mask_##isa( data + i, item );               \
+            if ( m ) {                                                  \
+                return i + 31 - __builtin_clz( m );                     \
+            }                                                           \
+        }                                                               \
+        return n;                                                       \
+    }                                                                   \
+    attr static po_size_t po_count_##isa( const po_d* data, po_size_t n, po_d item ) \
+    {                                                                   \
+        po_size_t i = 0;                                                \
+        po_size_t cnt = 0;                                              \
+        for ( ; i + 8 <= n; i += 8 ) {                                  \
+            cnt += __builtin_popcount( po_mask_##isa( data + i, item ) ); \
+        }                                                               \
+        return cnt + po_count_scalar( data + i, n - i, item );          \
+    }                                                                   \
+    static const po_find_kernel_s po_kernel_##isa = {                   \
+        po_find_##isa, po_find_last_##isa, po_count_##isa               \
+    }
+
+
+static inline unsigned po_mask_sse2( const po_d* data, po_d item )
+{
+    __m128i  key = _mm_set1_epi64x( (long long)(intptr_t)item );
+    unsigned m = 0;
+
+    for ( int j = 0; j < 4; j++ ) {
+        /* No 64-bit compare in SSE2: both 32-bit halves must match. */
+        __m128i c = _mm_cmpeq_epi32( _mm_loadu_si128( (const __m128i*)( data + 2 * j ) ), key );
+        c = _mm_and_si128( c, _mm_shuffle_epi32( c, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+        m |= (unsigned)_mm_movemask_pd( _mm_castsi128_pd( c ) ) << ( 2 * j );
+    }
+
+    return m;
+}
+
+__attribute__( ( target( "avx2" ) ) ) static inline unsigned po_mask_avx2( const po_d* data,
+                                                                         po_d        item )
+{
+    __m256i key = _mm256_set1_epi64x( (long long)(intptr_t)item );
+    __m256i a = _mm256_cmpeq_epi64( _mm256_loadu_si256( (const __m256i*)data ), key );
+    __m256i b = _mm256_cmpeq_epi64( _mm256_loadu_si256( (const __m256i*)( data + 4 ) ), key );
+
+    return (unsigned)_mm256_movemask_pd( _mm256_castsi256_pd( a ) )
+           | ( (unsigned)_mm256_movemask_pd( _mm256_castsi256_pd( b ) ) << 4 );
+}
+
+__attribute__( ( target( "avx512f" ) ) ) static inline unsigned po_mask_avx512( const po_d* data,
+                                                                              po_d        item )
+{
+    __m512i key = _mm512_set1_epi64( (long long)(intptr_t)item );
+    return _mm512_cmpeq_epi64_mask( _mm512_loadu_si512( data ), key );
+}
+
+po_simd_kernels( sse2, );
+po_simd_kernels( avx2, __attribute__( ( target( "avx2" ) ) ) );
+po_simd_kernels( avx512, __attribute__( ( target( "avx512f" ) ) ) );
+
+#endif /* PO_USE_SIMD */
+
+/** @endcond postor_none */
+
+
+/**
+ * Return search kernels for the CPU.
+ *
+ * Selection is made at first call.
+ *
+ * @return Kernels.
+ */
+static const po_find_kernel_s* po_find_kernel( void )
+{
+    static const po_find_kernel_s* kernel = NULL;
+    const po_find_kernel_s*        sel;
+
+    sel = __atomic_load_n( &kernel, __ATOMIC_RELAXED );
+    if ( sel ) {
+        return sel;
+    }
+
+    sel = &po_kernel_scalar;
+
+#ifdef PO_USE_SIMD
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx512f" ) ) {
+        sel = &po_kernel_avx512;
+    } else if ( __builtin_cpu_supports( "avx2" ) ) {
+        sel = &po_kernel_avx2;
+    } else {
+        sel = &po_kernel_sse2;
+    }
+#endif
+
+    __atomic_store_n( &kernel, sel, __ATOMIC_RELAXED );
+
+    return sel;
 }
 
 
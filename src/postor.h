@@ -35,6 +35,70 @@
 #define PO_DEFAULT_SIZE 16
 #endif
 
+#ifndef PO_MAX_THREADS
+/** Maximum thread count for parallel operations. */
+#define PO_MAX_THREADS 64
+#endif
+
+#ifndef PO_PARALLEL_MIN
+/** Minimum item count per thread in parallel operations. */
+#define PO_PARALLEL_MIN 4096
+#endif
+
+#ifndef PO_CC_SEGMENTS
+/** Segment count for Concurrent Postor (segment sizes double). */
+#define PO_CC_SEGMENTS 48
+#endif
+
+#ifndef PO_PREFETCH_DIST
+/** Prefetch distance (items) for po_visit(). */
+#define PO_PREFETCH_DIST 8
+#endif
+
+#ifndef PO_SEG_CHUNK
+/** Default chunk size for Segmented Postor (items). */
+#define PO_SEG_CHUNK 4096
+#endif
+
+#ifndef PO_CACHE_LINE
+/** Cache line size in bytes (for false sharing avoidance). */
+#define PO_CACHE_LINE 64
+#endif
+
+#ifndef PO_HUGE_PAGE
+/** Huge page size in bytes (for PO_MAP_HUGETLB). */
+#define PO_HUGE_PAGE ( 2 * 1024 * 1024 )
+#endif
+
+#ifndef PO_POOL_SHIFT
+/** Largest pooled size class, as power of two (POSTOR_USE_POOL). */
+#define PO_POOL_SHIFT 12
+#endif
+
+/** Largest pooled storage size (POSTOR_USE_POOL). */
+#define PO_POOL_MAX ( 1ULL << PO_POOL_SHIFT )
+
+#ifndef PO_POOL_CACHE
+/** Thread cache block count per size class (POSTOR_USE_POOL). */
+#define PO_POOL_CACHE 64
+#endif
+
+#ifndef PO_POOL_DEPOT
+/** Global depot block count per size class (POSTOR_USE_POOL). */
+#define PO_POOL_DEPOT 1024
+#endif
+
+#ifndef PO_SLAB_COUNT
+/** Descriptor count per slab (POSTOR_USE_POOL). */
+#define PO_SLAB_COUNT 64
+#endif
+
+/** Mapped storage: use explicit huge pages (MAP_HUGETLB), if available. */
+#define PO_MAP_HUGETLB 0x1
+
+/** Mapped storage: advise transparent huge pages (MADV_HUGEPAGE). */
+#define PO_MAP_THP 0x2
+
 /** Minimum size for pointer array. */
 #define PO_MIN_SIZE 2
 
@@ -51,6 +115,9 @@ typedef int64_t po_pos_t;
 /** Data pointer type. */
 typedef void* po_d;
 
+/** Postor extension (growth policy etc.), see po_set_growth(). */
+typedef struct po_ext_s* po_x;
+
 
 /**
  * Postor struct.
@@ -64,20 +131,168 @@ struct po_struct_s
     po_size_t size;      /**< Reservation size for data (N mod 2==0). */
     po_size_t used;      /**< Used count for data. */
     po_d*     data;      /**< Pointer array. */
+    po_x      ext;       /**< Extension (NULL for defaults). */
 };
 typedef struct po_struct_s po_s; /**< Postor struct. */
 typedef po_s*              po_t; /**< Postor. */
 typedef po_t*              po_p; /**< Postor reference. */
 
 
+/**
+ * Concurrent Postor struct, i.e. multi-producer append storage.
+ *
+ * Storage is a fixed directory of segments. Segment "k" has "base <<
+ * k" slots, and segments are allocated on demand. Segments are never
+ * moved, hence published slots stay valid while storage grows.
+ */
+struct po_cc_struct_s
+{
+    po_size_t base;                   /**< First segment size (2^N). */
+    po_size_t used;                   /**< Reserved slot count. */
+    po_d*     seg[ PO_CC_SEGMENTS ];  /**< Segments. */
+};
+typedef struct po_cc_struct_s po_cc_s; /**< Concurrent Postor struct. */
+typedef po_cc_s*              po_cc_t; /**< Concurrent Postor. */
+
+
+/**
+ * Ring Postor struct, i.e. single-producer/single-consumer FIFO.
+ *
+ * Consumer and producer counters are on separate cache lines, and
+ * both sides keep a cached copy of the other side's counter.
+ */
+struct po_spsc_struct_s
+{
+    po_d*     data;                        /**< Slot array (2^N). */
+    po_size_t mask;                        /**< Slot count - 1. */
+    char      pad0[ PO_CACHE_LINE ];       /**< Padding. */
+    po_size_t head;                        /**< Consumer counter. */
+    po_size_t tail_cache;                  /**< Consumer's copy of tail. */
+    char      pad1[ PO_CACHE_LINE ];       /**< Padding. */
+    po_size_t tail;                        /**< Producer counter. */
+    po_size_t head_cache;                  /**< Producer's copy of head. */
+    char      pad2[ PO_CACHE_LINE ];       /**< Padding. */
+};
+typedef struct po_spsc_struct_s po_spsc_s; /**< Ring Postor struct. */
+typedef po_spsc_s*              po_spsc_t; /**< Ring Postor. */
+
+
+/**
+ * Segmented Postor struct.
+ *
+ * Items are stored in fixed size chunks (2^shift items), and chunks
+ * are stored in a directory Postor.
+ */
+struct po_seg_struct_s
+{
+    po_size_t shift; /**< Chunk size as power of 2. */
+    po_size_t used;  /**< Item count. */
+    po_s      dir;   /**< Chunk directory. */
+};
+typedef struct po_seg_struct_s po_seg_s; /**< Segmented Postor struct. */
+typedef po_seg_s*              po_seg_t; /**< Segmented Postor. */
+
+
+/**
+ * Compressed Postor struct.
+ *
+ * Items are stored as 32-bit offsets relative to base. Offset is
+ * scaled with shift, and offset 0 encodes NULL.
+ */
+struct po_cp_struct_s
+{
+    char*     base;  /**< Base address. */
+    po_size_t shift; /**< Offset scale (alignment as power of 2). */
+    po_size_t used;  /**< Item count. */
+    po_size_t size;  /**< Storage size (items). */
+    uint32_t* data;  /**< Offset storage. */
+};
+typedef struct po_cp_struct_s po_cp_s; /**< Compressed Postor struct. */
+typedef po_cp_s*              po_cp_t; /**< Compressed Postor. */
+
+
+/**
+ * Record Postor struct.
+ *
+ * Fixed size records are stored inline in Postor data, either as
+ * records (AoS) or as columns of 64-bit fields (SoA).
+ */
+struct po_rec_struct_s
+{
+    po_t      po;    /**< Storage Postor. */
+    po_size_t bytes; /**< Record size. */
+    po_size_t width; /**< Record size (fields). */
+    po_size_t used;  /**< Record count. */
+    int       soa;   /**< Columns layout. */
+};
+typedef struct po_rec_struct_s po_rec_s; /**< Record Postor struct. */
+typedef po_rec_s*              po_rec_t; /**< Record Postor. */
+
+
+/**
+ * Postor statistics (POSTOR_USE_STATS), see po_stats_get().
+ *
+ * Statistics are global, i.e. cumulative over all Postors.
+ */
+typedef struct
+{
+    po_size_t resizes;      /**< Storage resizes (po_resize_to). */
+    po_size_t resize_bytes; /**< Bytes (re)allocated by resizes. */
+    po_size_t copy_bytes;   /**< Bytes copied/moved for storage changes. */
+    po_size_t clear_bytes;  /**< Bytes cleared (zeroed). */
+    po_size_t move_bytes;   /**< Bytes moved by inserts and deletes. */
+    po_size_t compares;     /**< Item comparisons by find operations. */
+    po_size_t peak_used;    /**< Peak usage of any Postor. */
+    po_size_t peak_size;    /**< Peak size of any Postor. */
+} po_stats_s;
+
+
+/** Arena mark (see po_arena_mark). */
+typedef struct
+{
+    po_size_t block; /**< Block number. */
+    po_size_t used;  /**< Usage in block. */
+} po_mark_s;
+
+
 /** Resize function type. */
 typedef int ( *po_resize_fn_p )( po_t po, po_size_t new_size, po_d state );
 
+/**
+ * Growth function type (PO_GROW_FN).
+ *
+ * Return reservation size for Postor that must fit at least
+ * "new_size" items. Returned size is legalized by Postor.
+ */
+typedef po_size_t ( *po_grow_fn_p )( po_t po, po_size_t new_size, po_d state );
+
+
+/** Growth policy for automatic resizing. */
+typedef enum
+{
+    PO_GROW_DOUBLE = 0, /**< Double the reservation (default). */
+    PO_GROW_HALF,       /**< Grow reservation by half (1.5x). */
+    PO_GROW_STEP,       /**< Grow reservation by fixed step. */
+    PO_GROW_FN,         /**< Use growth function (po_grow_fn_p). */
+} po_growth_t;
+
 /** Compare function type. */
 typedef int ( *po_compare_fn_p )( const po_d a, const po_d b );
 
+/** Hash function type (for po_index_attach). */
+typedef uint64_t ( *po_hash_fn_p )( const po_d item );
+
+/** Key function type (for po_sort_by_key). */
+typedef uint64_t ( *po_key_fn_p )( const po_d item, po_d state );
 
-/** Iterate over all items. */
+/** Predicate function type (non-zero for match). */
+typedef int ( *po_pred_fn_p )( const po_d item, po_d state );
+
+/** Visit function type (for po_visit). */
+typedef void ( *po_visit_fn_p )( po_d item, po_d state );
+
+
+/** Iterate over all items (stops at NULL item, see: po_visit). */
 #define po_each( po, iter, cast )                                       \
     for ( po_size_t po_idx = 0;                                         \
           ( po_idx < ( po )->used ) && ( iter = ( cast )( po )->data[ po_idx ] ); \
@@ -90,10 +305,10 @@ typedef int ( *po_compare_fn_p )( const po_d a, const po_d b );
 #define po_assign( po, idx, item ) ( ( po )->data[ ( idx ) ] = ( item ) )
 
 /** Shift item from first index. */
-#define po_shift( po ) po_delete_at( po, 0 )
+#define po_shift( po ) po_pop_front( po )
 
 /** Insert item to first index. */
-#define po_unshift( po, item ) po_insert_at( po, 0, item )
+#define po_unshift( po, item ) po_push_front( po, item )
 
 /** Postor unit size, e.g. use as unit for local allocations. */
 #define po_unitsize ( sizeof( po_d ) )
@@ -109,6 +324,31 @@ typedef int ( *po_compare_fn_p )( const po_d a, const po_d b );
     po_use( &ps, buf, ((((size-1)/2)+1)*2) )
 
 
+/**
+ * Declare Postor type with inline storage for "size" items.
+ *
+ * Inline Postor is embedded in user objects, and it does not need
+ * heap allocation until it spills to heap on growth (see po_use()).
+ * Descriptor is in the "po" field. NOTE: Inline Postor must not be
+ * moved in memory while it is local (po_get_local()).
+ *
+ *     po_inline_type( kids_t, 4 );
+ *     kids_t kids;
+ *     po_inline_init( &kids );
+ *     po_push( &kids.po, child );
+ */
+#define po_inline_type( name, size )                            \
+    typedef struct                                              \
+    {                                                           \
+        po_s po;                                                \
+        po_d buf[ ((((size-1)/2)+1)*2) ];                       \
+    } name
+
+/** Initialize inline Postor ("pi" is pointer to inline Postor). */
+#define po_inline_init( pi )                                    \
+    po_use( &( pi )->po, ( pi )->buf, sizeof( ( pi )->buf ) / sizeof( po_d ) )
+
+
 
 /* Short names for functions. */
 
@@ -116,7 +356,11 @@ typedef int ( *po_compare_fn_p )( const po_d a, const po_d b );
 #define ponew po_new
 #define posiz po_new_sized
 #define popag po_new_pages
+#define poare po_new_arena
+#define pomap po_new_mapped
+#define popck po_new_packed
 #define podes po_destroy
+#define porel po_release
 #define pores po_resize
 #define pouse po_used
 #define porss po_size
@@ -127,19 +371,55 @@ typedef int ( *po_compare_fn_p )( const po_d a, const po_d b );
 #define poemp po_is_empty
 #define pofll po_is_full
 #define popsh po_push
+#define popsn po_push_n
+#define poapp po_append_postor
 #define popop po_pop
+#define popsf po_push_front
+#define poppf po_pop_front
 #define poadd po_add
 #define porem po_remove
 #define porst po_reset
+#define poclu po_clear_used
+#define poscl po_set_clear
+#define posrn po_set_shrink
+#define posft po_shrink_to_fit
 #define podup po_duplicate
+#define podsh po_duplicate_shared
+#define pouns po_unshare
 #define poswp po_swap
 #define poins po_insert_at
 #define poiif po_insert_if
+#define poinn po_insert_n_at
 #define podel po_delete
+#define podun po_delete_unordered
+#define podrg po_delete_range
+#define poflt po_filter
+#define pormi po_remove_if
+#define posrt po_sort
+#define posrk po_sort_by_key
+#define posrp po_sort_parallel
 #define pofnd po_find
+#define pofnl po_find_last
+#define pocnt po_count
 #define pofnw po_find_with
+#define pofwp po_find_with_parallel
+#define poixa po_index_attach
+#define poixd po_index_detach
+#define poixf po_index_find
+#define poixq po_is_indexed
+#define pobsr po_bsearch
+#define polwb po_lower_bound
+#define poupb po_upper_bound
+#define poisr po_insert_sorted
 #define poalc po_alloc_bytes
-
+#define poala po_alloc_aligned
+#define poaar po_alloc_array
+#define poamk po_arena_mark
+#define poarw po_arena_rewind
+#define poarl po_arena_release
+
+#define povis po_visit
+#define povrg po_visit_range
 #define pofor po_for_each
 /** @endcond postor_none */
 
@@ -156,7 +436,7 @@ typedef int ( *po_compare_fn_p )( const po_d a, const po_d b );
  * If POSTOR_USE_MEM_API is used, the user must provide implementation for
  * the above functions and they must be compatible with malloc
  * etc. Also Postor assumes that po_malloc sets all new memory to
- * zero.
+ * zero. po_malloc_raw (non-clearing allocation) defaults to po_malloc.
  *
  * Additionally user should compile the library by own means.
  */
@@ -165,6 +445,10 @@ extern void* po_malloc( size_t size );
 extern void  po_free( void* ptr );
 extern void* po_realloc( void* ptr, size_t size );
 
+#    ifndef po_malloc_raw
+#        define po_malloc_raw po_malloc
+#    endif
+
 #else /* POSTOR_USE_MEM_API */
 
 
@@ -173,6 +457,7 @@ extern void* po_realloc( void* ptr, size_t size );
 #        define po_malloc  st_alloc
 #        define po_free    st_del
 #        define po_realloc st_realloc
+#        define po_malloc_raw st_alloc
 
 
 #    else /* SIXTEN_USE_MEM_API == 1 */
@@ -188,6 +473,9 @@ extern void* po_realloc( void* ptr, size_t size );
 /** Re-reserve memory. */
 #        define po_realloc realloc
 
+/** Reserve memory without clearing. */
+#        define po_malloc_raw malloc
+
 #    endif /* SIXTEN_USE_MEM_API == 1 */
 
 #endif /* POSTOR_USE_MEM_API */
@@ -250,6 +538,69 @@ po_t po_new_sized( po_t po, po_size_t size );
 po_t po_new_pages( po_t po, po_size_t count );
 
 
+/**
+ * Create growable arena Postor with page (4k) aligned blocks.
+ *
+ * If po is NULL, descriptor is allocated from heap. This
+ * type of descriptor must be freed by the user after use.
+ *
+ * Arena is like Paged Postor, but po_alloc_bytes() chains a new block
+ * of (at least) "count" pages when current block is consumed. Earlier
+ * blocks are not moved, i.e. returned addresses are stable. Blocks are
+ * released with po_destroy_storage().
+ *
+ * @param count Page count per block.
+ *
+ * @return Postor.
+ */
+po_t po_new_arena( po_t po, po_size_t count );
+
+
+/**
+ * Create Postor with mmap backed storage.
+ *
+ * If po is NULL, descriptor is allocated from heap. This
+ * type of descriptor must be freed by the user after use.
+ *
+ * Virtual address range of "reserve" items is reserved up front, and
+ * pages are committed by the kernel on first touch. Postor grows
+ * within the reservation without moving, and beyond it with mremap(),
+ * i.e. without copying the items. Mapped storage is intended for very
+ * large Postors.
+ *
+ * Flags (or'ed):
+ * - PO_MAP_HUGETLB: Use explicit huge pages, fall back to normal pages
+ *   if huge pages are not available.
+ * - PO_MAP_THP: Advise transparent huge pages.
+ *
+ * Without mmap support (non-Linux or POSTOR_NO_MMAP), Postor is heap
+ * allocated as with po_new_sized().
+ *
+ * @param po      Postor descriptor or NULL.
+ * @param size    Initial size.
+ * @param reserve Reserved size (max of size and reserve is used).
+ * @param flags   Mapping flags (PO_MAP_*).
+ *
+ * @return Postor.
+ */
+po_t po_new_mapped( po_t po, po_size_t size, po_size_t reserve, int flags );
+
+
+/**
+ * Create heap Postor with descriptor and data in one allocation.
+ *
+ * Data follows the descriptor, which improves locality and halves the
+ * allocation count. Data is marked "local", hence Postor spills to
+ * separate heap storage on growth, and the initial data is released
+ * with the descriptor by po_destroy().
+ *
+ * @param size Initial size.
+ *
+ * @return Postor (or NULL).
+ */
+po_t po_new_packed( po_size_t size );
+
+
 /** 
  * Initialize the Postor as empty.
  * 
@@ -287,15 +638,33 @@ po_t po_destroy( po_t po );
 /**
  * Destroy Postor storage (data).
  *
+ * Settings (growth policy, resize function, clearing, shrinking and
+ * index) are kept, i.e. Postor can be reused with po_add(). Settings
+ * are released with po_release() or po_destroy(). Postor without
+ * settings needs no po_release().
+ *
  * @param po Postor.
  */
 void po_destroy_storage( po_t po );
 
 
+/**
+ * Destroy Postor storage and settings.
+ *
+ * Descriptor is not freed, i.e. this is the final cleanup for Postor
+ * in user memory. Postor that has settings must be released before it
+ * is discarded or reinitialized (e.g. with po_new()).
+ *
+ * @param po Postor.
+ */
+void po_release( po_t po );
+
+
 /**
  * Resize Postor to new_size.
  *
- * If new_size is smaller than usage, no action is performed.
+ * If new_size is smaller than usage, no action is performed. With
+ * PO_GROW_FN policy, new_size is passed through the resize function.
  *
  * @param po       Postor.
  * @param new_size Requested size.
@@ -303,6 +672,96 @@ void po_destroy_storage( po_t po );
 void po_resize( po_t po, po_size_t new_size );
 
 
+/**
+ * Set growth policy for Postor.
+ *
+ * Policy is consulted whenever Postor is resized automatically,
+ * i.e. by po_push() and po_insert_at(). "step" is used only with
+ * PO_GROW_STEP. Policy is kept over po_destroy_storage(), and
+ * released with po_release() (or po_destroy()). PO_GROW_FN is accepted only
+ * if resize function has been set (po_set_resize_fn()).
+ *
+ * @param po     Postor.
+ * @param growth Growth policy.
+ * @param step   Step size for PO_GROW_STEP.
+ *
+ * @return 1 on success (0 on allocation failure or missing function).
+ */
+int po_set_growth( po_t po, po_growth_t growth, po_size_t step );
+
+
+/**
+ * Set user resize function as growth policy (PO_GROW_FN).
+ *
+ * Resize function is consulted by automatic resizing and also by
+ * po_resize(), i.e. it may adjust explicit resize requests.
+ *
+ * @param po     Postor.
+ * @param resize Resize function (not NULL).
+ * @param state  State for resize function.
+ *
+ * @return 1 on success (0 on allocation failure or NULL function).
+ */
+int po_set_resize_fn( po_t po, po_grow_fn_p resize, po_d state );
+
+
+/**
+ * Return growth policy of Postor.
+ *
+ * @param po Postor.
+ *
+ * @return Growth policy.
+ */
+po_growth_t po_get_growth( po_t po );
+
+
+/**
+ * Set clearing of new storage for Postor.
+ *
+ * By default, memory is cleared when Postor grows. Slots after usage
+ * are not read by Postor, hence clearing can be disabled for large
+ * Postors, which avoids touching pages that are not used yet.
+ *
+ * Clearing is disabled for all Postors (including po_use(),
+ * po_new_sized() and po_alloc_pages()), when library is compiled with
+ * POSTOR_NO_CLEAR.
+ *
+ * @param po    Postor.
+ * @param clear Clear new storage (0 to disable).
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+int po_set_clear( po_t po, int clear );
+
+
+/**
+ * Set automatic shrinking for Postor.
+ *
+ * Reservation is halved when usage drops below quarter of it, after
+ * item removal (e.g. po_pop(), po_delete_at(), po_reset()). Usage
+ * must double before Postor grows again, i.e. Postor does not thrash
+ * at the limit. Reservation is not shrunk below PO_DEFAULT_SIZE. Local
+ * and arena storage is not shrunk.
+ *
+ * @param po     Postor.
+ * @param shrink Shrink automatically (0 to disable).
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+int po_set_shrink( po_t po, int shrink );
+
+
+/**
+ * Shrink Postor reservation to fit usage.
+ *
+ * Freed memory is returned to the system, also for mapped
+ * storage. Local and arena storage is not shrunk.
+ *
+ * @param po Postor.
+ */
+void po_shrink_to_fit( po_t po );
+
+
 /**
  * Push item to end of container.
  *
@@ -315,6 +774,63 @@ void po_resize( po_t po, po_size_t new_size );
 void po_push( po_t po, po_d item );
 
 
+/**
+ * Push number of items to end of container.
+ *
+ * Postor is resized at most once. "items" may point to the items of
+ * Postor itself (e.g. po_data()), since such items are relocated with
+ * the storage.
+ *
+ * @param po    Postor.
+ * @param items Items to push.
+ * @param count Item count.
+ */
+void po_push_n( po_t po, const po_d* items, po_size_t count );
+
+
+/**
+ * Append all items of another Postor to end of container. "other"
+ * may be "po" itself.
+ *
+ * @param po    Postor.
+ * @param other Postor to append.
+ */
+void po_append_postor( po_t po, po_t other );
+
+
+/**
+ * Push item to start of container.
+ *
+ * Postor keeps headroom (free slots) before the first item, hence
+ * push to start is amortized O(1). Headroom is created when needed,
+ * by moving the items or by resizing. po_data() changes.
+ *
+ * Local Postor (po_use(), po_new_packed()) without extension does not
+ * keep headroom, i.e. items are moved as with po_insert_at().
+ *
+ * @param po   Postor.
+ * @param item Item to push.
+ */
+void po_push_front( po_t po, po_d item );
+
+
+/**
+ * Pop item from start of container.
+ *
+ * Popping is O(1), i.e. the data pointer is advanced and the slot
+ * becomes headroom. Postor can hence be used as FIFO (or deque)
+ * with po_push() and po_pop_front(). po_data() changes.
+ *
+ * Pop does not allocate storage. Items are moved instead, when Postor
+ * is local without extension, or when the allocation is full.
+ *
+ * @param po Postor.
+ *
+ * @return Popped item (or NULL).
+ */
+po_d po_pop_front( po_t po );
+
+
 /**
  * Pop item from end of container.
  *
@@ -357,7 +873,8 @@ void po_add( po_t po, po_d item );
 /**
  * Remove item from end of container.
  *
- * If container becomes empty, it will be destroyed.
+ * If container becomes empty, its storage will be destroyed (see
+ * po_destroy_storage()). Settings are kept for reuse.
  *
  * @param po Postor.
  *
@@ -382,6 +899,17 @@ void po_reset( po_t po );
 void po_clear( po_t po );
 
 
+/**
+ * Clear used items and reset Postor to empty.
+ *
+ * Only slots up to usage are cleared, i.e. reserved slots are not
+ * touched.
+ *
+ * @param po Postor.
+ */
+void po_clear_used( po_t po );
+
+
 /**
  * Duplicate Postor.
  *
@@ -392,6 +920,46 @@ void po_clear( po_t po );
 po_s po_duplicate( po_t po );
 
 
+/**
+ * Duplicate Postor with shared (copy-on-write) storage.
+ *
+ * Duplicate shares storage with Postor, and storage is copied by the
+ * first mutating call (e.g. po_push(), po_swap(), po_insert_at(),
+ * po_delete_at(), po_sort()) of either. Storage is freed by the last
+ * holder. Reference count is atomic, i.e. holders may be used from
+ * different threads.
+ *
+ * Writes through po_data(), po_item() or po_assign() bypass the copy,
+ * hence po_unshare() must be called before them.
+ *
+ * Local, mapped and arena Postors, and Postors with headroom, are
+ * duplicated with po_duplicate().
+ *
+ * @param po Postor to duplicate.
+ *
+ * @return Duplicated postor.
+ */
+po_s po_duplicate_shared( po_t po );
+
+
+/**
+ * Make storage private, i.e. copy shared storage (if shared).
+ *
+ * @param po Postor.
+ */
+void po_unshare( po_t po );
+
+
+/**
+ * Return Postor shared mode.
+ *
+ * @param po Postor.
+ *
+ * @return 1 if storage is shared (else 0).
+ */
+int po_is_shared( po_t po );
+
+
 /**
  * Swap item in Postor with given "item".
  *
@@ -430,6 +998,20 @@ void po_insert_at( po_t po, po_pos_t pos, po_d item );
 int po_insert_if( po_t po, po_pos_t pos, po_d item );
 
 
+/**
+ * Insert number of items to given position.
+ *
+ * Postor is resized at most once, and the container tail is moved
+ * only once. "items" must not refer to Postor's own data.
+ *
+ * @param po    Postor.
+ * @param pos   Position.
+ * @param items Items to insert.
+ * @param count Item count.
+ */
+void po_insert_n_at( po_t po, po_pos_t pos, const po_d* items, po_size_t count );
+
+
 /**
  * Delete item from position.
  *
@@ -444,27 +1026,812 @@ po_d po_delete_at( po_t po, po_pos_t pos );
 
 
 /**
- * Sort Postor items.
+ * Delete item from position by moving the last item to its place.
  *
- * @param po      Postor.
- * @param compare Compare function.
+ * Item order is not preserved, but deletion is O(1).
+ *
+ * @param po  Postor.
+ * @param pos Position.
+ *
+ * @return Item from delete position.
  */
-void po_sort( po_t po, po_compare_fn_p compare );
+po_d po_delete_unordered( po_t po, po_pos_t pos );
 
 
 /**
- * Allocate consecutive bytes from Postor.
+ * Delete range of items starting from position.
  *
- * Allocation is converted to next Postor unit size, i.e. the minimum
+ * If count extends past the end, the items until end are deleted.
+ *
+ * @param po    Postor.
+ * @param pos   Position.
+ * @param count Item count.
+ *
+ * @return Number of items deleted.
+ */
+po_size_t po_delete_range( po_t po, po_pos_t pos, po_size_t count );
+
+
+/**
+ * Keep items for which "keep" returns non-zero, delete the rest.
+ *
+ * Items are compacted in one pass, and the order of kept items is
+ * preserved.
+ *
+ * @param po    Postor.
+ * @param keep  Predicate for items to keep.
+ * @param state State for predicate.
+ *
+ * @return Number of items deleted.
+ */
+po_size_t po_filter( po_t po, po_pred_fn_p keep, po_d state );
+
+
+/**
+ * Delete items for which "match" returns non-zero.
+ *
+ * Items are compacted in one pass, and the order of remaining items
+ * is preserved.
+ *
+ * @param po    Postor.
+ * @param match Predicate for items to delete.
+ * @param state State for predicate.
+ *
+ * @return Number of items deleted.
+ */
+po_size_t po_remove_if( po_t po, po_pred_fn_p match, po_d state );
+
+
+/**
+ * Sort Postor items.
+ *
+ * Compare function gets references to items (as with qsort). Sort is
+ * pattern-defeating quicksort (not stable). For inlined compare, see
+ * po_sort_define() in postor_sort.h.
+ *
+ * @param po      Postor.
+ * @param compare Compare function.
+ */
+void po_sort( po_t po, po_compare_fn_p compare );
+
+
+/**
+ * Sort Postor items using multiple threads.
+ *
+ * Chunks are sorted in parallel and then merged in parallel. Result
+ * is same as with po_sort() for items that are distinct by "compare".
+ * Equal items are in deterministic order for given thread count.
+ *
+ * If threads is 0, online CPU count is used. Thread count is
+ * limited so that each thread has at least PO_PARALLEL_MIN items.
+ *
+ * @param po      Postor.
+ * @param compare Compare function.
+ * @param threads Thread count (0 for CPU count).
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+int po_sort_parallel( po_t po, po_compare_fn_p compare, po_size_t threads );
+
+
+/**
+ * Sort Postor items by 64-bit key (ascending).
+ *
+ * Key is extracted once per item, and (key, item) pairs are radix
+ * sorted. Sort is stable.
+ *
+ * @param po    Postor.
+ * @param key   Key function.
+ * @param state State for key function.
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+int po_sort_by_key( po_t po, po_key_fn_p key, po_d state );
+
+
+/**
+ * Binary search item from sorted Postor.
+ *
+ * Postor must be sorted with "compare", e.g. using po_sort(). Compare
+ * function receives references to items, as with po_sort().
+ *
+ * @param po      Postor.
+ * @param compare Compare function.
+ * @param ref     Item to find.
+ *
+ * @return Index of first matching item (or PO_NOT_INDEX).
+ */
+po_pos_t po_bsearch( po_t po, po_compare_fn_p compare, po_d ref );
+
+
+/**
+ * Return index of first item that is not less than "ref".
+ *
+ * Postor must be sorted with "compare" (see: po_bsearch).
+ *
+ * @param po      Postor.
+ * @param compare Compare function.
+ * @param ref     Reference item.
+ *
+ * @return Index (po_used() if all items are less).
+ */
+po_size_t po_lower_bound( po_t po, po_compare_fn_p compare, po_d ref );
+
+
+/**
+ * Return index of first item that is greater than "ref".
+ *
+ * Postor must be sorted with "compare" (see: po_bsearch).
+ *
+ * @param po      Postor.
+ * @param compare Compare function.
+ * @param ref     Reference item.
+ *
+ * @return Index (po_used() if no item is greater).
+ */
+po_size_t po_upper_bound( po_t po, po_compare_fn_p compare, po_d ref );
+
+
+/**
+ * Insert item to sorted Postor keeping the order.
+ *
+ * Item is inserted after equal items. Postor is resized if these is
+ * no space available.
+ *
+ * @param po      Postor.
+ * @param compare Compare function.
+ * @param item    Item to insert.
+ *
+ * @return Insert position.
+ */
+po_size_t po_insert_sorted( po_t po, po_compare_fn_p compare, po_d item );
+
+
+/**
+ * Allocate consecutive bytes from Postor.
+ *
+ * Allocation is converted to next Postor unit size, i.e. the minimum
  * allocation is one Postor unit. If Postor is full, NULL is returned
- * and Postor is not resized.
+ * and Postor is not resized. Arena Postor (po_new_arena()) chains a
+ * new block instead.
+ *
+ * @param po    Postor.
+ * @param bytes Number of bytes to allocate.
+ *
+ * @return Pointer (or NULL).
+ */
+po_d po_alloc_bytes( po_t po, po_size_t bytes );
+
+
+/**
+ * Allocate consecutive bytes from Postor with alignment.
+ *
+ * Like po_alloc_bytes(), but the allocation is padded to start at
+ * "align" byte boundary. Alignment must be power of two, and
+ * alignments below Postor unit size are rounded up to unit size.
+ *
+ * @param po    Postor.
+ * @param bytes Number of bytes to allocate.
+ * @param align Alignment in bytes.
+ *
+ * @return Pointer (or NULL).
+ */
+po_d po_alloc_aligned( po_t po, po_size_t bytes, po_size_t align );
+
+
+/**
+ * Allocate array of "count" elements from Postor with alignment.
+ *
+ * NULL is returned if total size overflows.
+ *
+ * @param po        Postor.
+ * @param count     Element count.
+ * @param elem_size Element size in bytes.
+ * @param align     Alignment in bytes.
+ *
+ * @return Pointer (or NULL).
+ */
+po_d po_alloc_array( po_t po, po_size_t count, po_size_t elem_size, po_size_t align );
+
+
+/**
+ * Return arena mark, i.e. current allocation position.
+ *
+ * @param po Postor.
+ *
+ * @return Mark.
+ */
+po_mark_s po_arena_mark( po_t po );
+
+
+/**
+ * Rewind arena to mark.
+ *
+ * Allocations after mark are released, i.e. blocks chained after
+ * mark are freed, and the rewound memory is cleared for reuse.
+ *
+ * @param po   Postor.
+ * @param mark Mark.
+ */
+void po_arena_rewind( po_t po, po_mark_s mark );
+
+
+/**
+ * Release all arena allocations.
+ *
+ * All chained blocks are freed, and the first block is kept for
+ * reuse.
+ *
+ * @param po Postor.
+ */
+void po_arena_release( po_t po );
+
+
+
+/* ------------------------------------------------------------
+ * Concurrent Postor:
+ */
+
+
+/**
+ * Create Concurrent Postor.
+ *
+ * If cc is NULL, descriptor is allocated from heap. Base size is
+ * rounded up to power of 2. First segment is allocated immediately.
+ *
+ * Concurrent Postor supports lock-free appends from multiple threads
+ * (po_cc_push()). Readers may access published slots concurrently
+ * with appends. NULL items are not supported, since NULL marks a
+ * reserved but not yet published slot.
+ *
+ * @param cc   Concurrent Postor or NULL.
+ * @param base First segment size.
+ *
+ * @return Concurrent Postor (or NULL).
+ */
+po_cc_t po_cc_new( po_cc_t cc, po_size_t base );
+
+
+/**
+ * Destroy Concurrent Postor storage (segments).
+ *
+ * No concurrent access is allowed.
+ *
+ * @param cc Concurrent Postor.
+ */
+void po_cc_destroy_storage( po_cc_t cc );
+
+
+/**
+ * Destroy Concurrent Postor, including heap descriptor.
+ *
+ * @param cc Concurrent Postor.
+ *
+ * @return NULL.
+ */
+po_cc_t po_cc_destroy( po_cc_t cc );
+
+
+/**
+ * Append item (thread safe, lock-free).
+ *
+ * Slot is reserved with atomic increment, and the item is published
+ * with release semantics.
+ *
+ * If segment allocation fails (or capacity is exhausted), the
+ * reserved slot is left unpublished and PO_NOT_INDEX is returned.
+ *
+ * @param cc   Concurrent Postor.
+ * @param item Item (non-NULL).
+ *
+ * @return Item index (or PO_NOT_INDEX).
+ */
+po_size_t po_cc_push( po_cc_t cc, po_d item );
+
+
+/**
+ * Return item at index (thread safe).
+ *
+ * @param cc  Concurrent Postor.
+ * @param idx Item index.
+ *
+ * @return Item (or NULL if not published).
+ */
+po_d po_cc_nth( po_cc_t cc, po_size_t idx );
+
+
+/**
+ * Return reserved slot count (thread safe).
+ *
+ * @param cc Concurrent Postor.
+ *
+ * @return Reserved count.
+ */
+po_size_t po_cc_used( po_cc_t cc );
+
+
+/**
+ * Append all published items to Postor.
+ *
+ * Typically used when producers are done.
+ *
+ * @param cc Concurrent Postor.
+ * @param po Postor.
+ *
+ * @return Number of items appended.
+ */
+po_size_t po_cc_collect( po_cc_t cc, po_t po );
+
+
+
+/* ------------------------------------------------------------
+ * Ring Postor (SPSC):
+ */
+
+
+/**
+ * Create Ring Postor.
+ *
+ * If sp is NULL, descriptor is allocated from heap. Size is rounded
+ * up to power of 2.
+ *
+ * Ring Postor is a lock-free FIFO for one producer thread
+ * (po_spsc_push()) and one consumer thread (po_spsc_pop()). NULL
+ * items are not supported.
+ *
+ * NOTE: sp->data is NULL, if allocation error occurred.
+ *
+ * @param sp   Ring Postor or NULL.
+ * @param size Slot count.
+ *
+ * @return Ring Postor (or NULL).
+ */
+po_spsc_t po_spsc_new( po_spsc_t sp, po_size_t size );
+
+
+/**
+ * Destroy Ring Postor storage.
+ *
+ * @param sp Ring Postor.
+ */
+void po_spsc_destroy_storage( po_spsc_t sp );
+
+
+/**
+ * Destroy Ring Postor, including heap descriptor.
+ *
+ * @param sp Ring Postor.
+ *
+ * @return NULL.
+ */
+po_spsc_t po_spsc_destroy( po_spsc_t sp );
+
+
+/**
+ * Push item to Ring Postor (producer only).
+ *
+ * @param sp   Ring Postor.
+ * @param item Item (non-NULL).
+ *
+ * @return 1 if pushed (0 if full).
+ */
+int po_spsc_push( po_spsc_t sp, po_d item );
+
+
+/**
+ * Pop item from Ring Postor (consumer only).
+ *
+ * @param sp Ring Postor.
+ *
+ * @return Item (or NULL if empty).
+ */
+po_d po_spsc_pop( po_spsc_t sp );
+
+
+/**
+ * Return item count in Ring Postor.
+ *
+ * Count is a snapshot when used concurrently.
+ *
+ * @param sp Ring Postor.
+ *
+ * @return Item count.
+ */
+po_size_t po_spsc_used( po_spsc_t sp );
+
+
+
+/* ------------------------------------------------------------
+ * Segmented Postor:
+ */
+
+
+/**
+ * Create Segmented Postor.
+ *
+ * If sg is NULL, descriptor is allocated from heap. Chunk size is
+ * rounded up to power of 2, and 0 selects PO_SEG_CHUNK.
+ *
+ * Segmented Postor grows by adding chunks, i.e. items are never
+ * copied and item addresses (po_seg_nth_ref()) are stable until the
+ * item is popped. Items are scanned chunk by chunk with
+ * po_seg_chunk():
+ *
+ *     for ( k = 0; ( chunk = po_seg_chunk( sg, k, &n ) ); k++ )
+ *         for ( i = 0; i < n; i++ )
+ *             visit( chunk[ i ] );
+ *
+ * @param sg    Segmented Postor or NULL.
+ * @param chunk Chunk size (items).
+ *
+ * @return Segmented Postor (or NULL).
+ */
+po_seg_t po_seg_new( po_seg_t sg, po_size_t chunk );
+
+
+/**
+ * Destroy Segmented Postor storage (chunks).
+ *
+ * @param sg Segmented Postor.
+ */
+void po_seg_destroy_storage( po_seg_t sg );
+
+
+/**
+ * Destroy Segmented Postor, including heap descriptor.
+ *
+ * @param sg Segmented Postor.
+ *
+ * @return NULL.
+ */
+po_seg_t po_seg_destroy( po_seg_t sg );
+
+
+/**
+ * Push item to end of Segmented Postor.
+ *
+ * @param sg   Segmented Postor.
+ * @param item Item.
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+int po_seg_push( po_seg_t sg, po_d item );
+
+
+/**
+ * Pop item from end of Segmented Postor.
+ *
+ * Chunks are kept for reuse.
+ *
+ * @param sg Segmented Postor.
+ *
+ * @return Item (or NULL if empty).
+ */
+po_d po_seg_pop( po_seg_t sg );
+
+
+/**
+ * Return item at index.
+ *
+ * @param sg  Segmented Postor.
+ * @param idx Item index.
+ *
+ * @return Item (or NULL if out of range).
+ */
+po_d po_seg_nth( po_seg_t sg, po_size_t idx );
+
+
+/**
+ * Return reference to item at index.
+ *
+ * Reference is stable, i.e. it is not invalidated by pushes.
+ *
+ * @param sg  Segmented Postor.
+ * @param idx Item index.
+ *
+ * @return Item reference (or NULL if out of range).
+ */
+po_d* po_seg_nth_ref( po_seg_t sg, po_size_t idx );
+
+
+/**
+ * Return item count.
  *
- * @param po    Postor.
- * @param bytes Number of bytes to allocate.
+ * @param sg Segmented Postor.
  *
- * @return Pointer (or NULL).
+ * @return Item count.
  */
-po_d po_alloc_bytes( po_t po, po_size_t bytes );
+po_size_t po_seg_used( po_seg_t sg );
+
+
+/**
+ * Return chunk with items.
+ *
+ * @param sg    Segmented Postor.
+ * @param k     Chunk index.
+ * @param count Item count in chunk (output).
+ *
+ * @return Chunk (or NULL if k is beyond items).
+ */
+po_d* po_seg_chunk( po_seg_t sg, po_size_t k, po_size_t* count );
+
+
+/**
+ * Reset Segmented Postor to empty (chunks are kept).
+ *
+ * @param sg Segmented Postor.
+ */
+void po_seg_reset( po_seg_t sg );
+
+
+
+/* ------------------------------------------------------------
+ * Compressed Postor:
+ */
+
+
+/**
+ * Create Compressed Postor.
+ *
+ * If cp is NULL, descriptor is allocated from heap.
+ *
+ * Items are stored as 32-bit offsets from base, i.e. storage is half
+ * of Postor storage. Typically base is the data of a Paged Postor
+ * (po_data()) and items are allocated with po_alloc_bytes(). With
+ * shift 0 items may be within 4 GB from base, and with shift 3 (8
+ * byte aligned items) within 32 GB.
+ *
+ * @param cp    Compressed Postor or NULL.
+ * @param base  Base address.
+ * @param shift Offset scale (0-3).
+ *
+ * @return Compressed Postor (or NULL).
+ */
+po_cp_t po_cp_new( po_cp_t cp, void* base, po_size_t shift );
+
+
+/**
+ * Destroy Compressed Postor storage.
+ *
+ * @param cp Compressed Postor.
+ */
+void po_cp_destroy_storage( po_cp_t cp );
+
+
+/**
+ * Destroy Compressed Postor, including heap descriptor.
+ *
+ * @param cp Compressed Postor.
+ *
+ * @return NULL.
+ */
+po_cp_t po_cp_destroy( po_cp_t cp );
+
+
+/**
+ * Check if item can be stored to Compressed Postor.
+ *
+ * Item must be NULL, or aligned and within range from base.
+ *
+ * @param cp   Compressed Postor.
+ * @param item Item.
+ *
+ * @return 1 if item is storable.
+ */
+int po_cp_fits( po_cp_t cp, po_d item );
+
+
+/**
+ * Push item to end of Compressed Postor.
+ *
+ * @param cp   Compressed Postor.
+ * @param item Item.
+ *
+ * @return 1 on success (0 if item does not fit or on allocation failure).
+ */
+int po_cp_push( po_cp_t cp, po_d item );
+
+
+/**
+ * Pop item from end of Compressed Postor.
+ *
+ * @param cp Compressed Postor.
+ *
+ * @return Item (or NULL if empty).
+ */
+po_d po_cp_pop( po_cp_t cp );
+
+
+/**
+ * Return item at index.
+ *
+ * @param cp  Compressed Postor.
+ * @param idx Item index.
+ *
+ * @return Item (or NULL if out of range).
+ */
+po_d po_cp_nth( po_cp_t cp, po_size_t idx );
+
+
+/**
+ * Find item from Compressed Postor.
+ *
+ * Item is encoded once, and search compares offsets.
+ *
+ * @param cp   Compressed Postor.
+ * @param item Item to find.
+ *
+ * @return Item index (or PO_NOT_INDEX).
+ */
+po_pos_t po_cp_find( po_cp_t cp, po_d item );
+
+
+/**
+ * Return item count.
+ *
+ * @param cp Compressed Postor.
+ *
+ * @return Item count.
+ */
+po_size_t po_cp_used( po_cp_t cp );
+
+
+/**
+ * Reset Compressed Postor to empty (storage is kept).
+ *
+ * @param cp Compressed Postor.
+ */
+void po_cp_reset( po_cp_t cp );
+
+
+
+/* ------------------------------------------------------------
+ * Record Postor:
+ */
+
+
+/**
+ * Create Record Postor.
+ *
+ * If rc is NULL, descriptor is allocated from heap.
+ *
+ * Records are stored inline in the (empty) storage Postor, hence
+ * Postor growth policy, local buffer (po_use()) and mapped storage
+ * (po_new_mapped()) apply. Storage Postor is owned by user and must
+ * not be used directly while Record Postor is in use.
+ *
+ * Record is split into 64-bit fields. In columns layout (soa) each
+ * field is stored in its own column, and scan of one field is a
+ * stream over continuous memory:
+ *
+ *     col = po_rec_column( rc, 1, &stride );
+ *     for ( i = 0; i < po_rec_used( rc ); i++ )
+ *         sum += col[ i * stride ];
+ *
+ * @param rc    Record Postor or NULL.
+ * @param po    Storage Postor.
+ * @param bytes Record size.
+ * @param soa   Use columns layout.
+ *
+ * @return Record Postor (or NULL).
+ */
+po_rec_t po_rec_new( po_rec_t rc, po_t po, po_size_t bytes, int soa );
+
+
+/**
+ * Destroy Record Postor heap descriptor.
+ *
+ * Storage is released with storage Postor.
+ *
+ * @param rc Record Postor.
+ *
+ * @return NULL.
+ */
+po_rec_t po_rec_destroy( po_rec_t rc );
+
+
+/**
+ * Push record to end of Record Postor.
+ *
+ * @param rc  Record Postor.
+ * @param rec Record (or NULL for cleared record).
+ *
+ * @return Record index.
+ */
+po_size_t po_rec_push( po_rec_t rc, const void* rec );
+
+
+/**
+ * Pop record from end of Record Postor.
+ *
+ * @param rc  Record Postor.
+ * @param rec Record (output, or NULL).
+ *
+ * @return 1 on success (0 if empty).
+ */
+int po_rec_pop( po_rec_t rc, void* rec );
+
+
+/**
+ * Return reference to record at index.
+ *
+ * Reference is valid until Record Postor grows.
+ *
+ * @param rc  Record Postor.
+ * @param idx Record index.
+ *
+ * @return Record (or NULL if out of range or columns layout).
+ */
+void* po_rec_nth( po_rec_t rc, po_size_t idx );
+
+
+/**
+ * Copy record at index.
+ *
+ * @param rc  Record Postor.
+ * @param idx Record index.
+ * @param rec Record (output).
+ *
+ * @return 1 on success (0 if out of range).
+ */
+int po_rec_get( po_rec_t rc, po_size_t idx, void* rec );
+
+
+/**
+ * Set record at index.
+ *
+ * @param rc  Record Postor.
+ * @param idx Record index.
+ * @param rec Record.
+ *
+ * @return 1 on success (0 if out of range).
+ */
+int po_rec_set( po_rec_t rc, po_size_t idx, const void* rec );
+
+
+/**
+ * Return reference to record field.
+ *
+ * @param rc    Record Postor.
+ * @param idx   Record index.
+ * @param field Field index (64-bit unit in record).
+ *
+ * @return Field (or NULL if out of range).
+ */
+uint64_t* po_rec_field( po_rec_t rc, po_size_t idx, po_size_t field );
+
+
+/**
+ * Return field column.
+ *
+ * Field of record i is at column[ i * stride ]. Stride is 1 for
+ * columns layout and record width otherwise.
+ *
+ * @param rc     Record Postor.
+ * @param field  Field index.
+ * @param stride Stride (output).
+ *
+ * @return Column (or NULL if field is out of range).
+ */
+uint64_t* po_rec_column( po_rec_t rc, po_size_t field, po_size_t* stride );
+
+
+/**
+ * Return record count.
+ *
+ * @param rc Record Postor.
+ *
+ * @return Record count.
+ */
+po_size_t po_rec_used( po_rec_t rc );
+
+
+/**
+ * Reset Record Postor to empty (storage is kept).
+ *
+ * @param rc Record Postor.
+ */
+void po_rec_reset( po_rec_t rc );
 
 
 
@@ -518,7 +1885,7 @@ po_d* po_data( po_t po );
  *
  * @param po Postor.
  *
- * @return First item.
+ * @return First item (or NULL if empty).
  */
 po_d po_first( po_t po );
 
@@ -528,7 +1895,7 @@ po_d po_first( po_t po );
  *
  * @param po Postor.
  *
- * @return Last item.
+ * @return Last item (or NULL if empty).
  */
 po_d po_last( po_t po );
 
@@ -582,7 +1949,9 @@ int po_is_full( po_t po );
 /**
  * Find item from Postor.
  *
- * Direct address comparison (see: po_find_with).
+ * Direct address comparison (see: po_find_with). Search is
+ * vectorized, if CPU supports it (x86-64 with SSE2/AVX2/AVX-512),
+ * unless POSTOR_NO_SIMD is defined.
  *
  * @param po   Postor.
  * @param item Item to find.
@@ -592,6 +1961,32 @@ int po_is_full( po_t po );
 po_pos_t po_find( po_t po, po_d item );
 
 
+/**
+ * Find last occurrence of item from Postor.
+ *
+ * Direct address comparison.
+ *
+ * @param po   Postor.
+ * @param item Item to find.
+ *
+ * @return Item index (or PO_NOT_INDEX).
+ */
+po_pos_t po_find_last( po_t po, po_d item );
+
+
+/**
+ * Count occurrences of item in Postor.
+ *
+ * Direct address comparison.
+ *
+ * @param po   Postor.
+ * @param item Item to count.
+ *
+ * @return Item count.
+ */
+po_size_t po_count( po_t po, po_d item );
+
+
 /**
  * Find item from Postor using compare function.
  *
@@ -604,6 +1999,116 @@ po_pos_t po_find( po_t po, po_d item );
 po_pos_t po_find_with( po_t po, po_compare_fn_p compare, po_d ref );
 
 
+/**
+ * Find item from Postor using compare function and multiple threads.
+ *
+ * Postor is split into chunks, which are scanned in parallel. Scan
+ * stops when a match is found at a lower index. Lowest matching
+ * index is returned, i.e. result is same as with po_find_with().
+ *
+ * If threads is 0, online CPU count is used. Thread count is
+ * limited so that each thread has at least PO_PARALLEL_MIN items.
+ *
+ * @param po      Postor.
+ * @param compare Compare function.
+ * @param ref     Item to find.
+ * @param threads Thread count (0 for CPU count).
+ *
+ * @return Item index (or PO_NOT_INDEX).
+ */
+po_pos_t po_find_with_parallel( po_t po, po_compare_fn_p compare, po_d ref, po_size_t threads );
+
+
+/**
+ * Attach hash index to Postor.
+ *
+ * Index maps items to positions, and it makes po_index_find() (and
+ * po_find() with identity index) O(1). Index is kept in sync by
+ * Postor functions, but not if data is modified directly
+ * (e.g. po_assign() or po_data()). Single item operations update the
+ * index incrementally, and bulk operations rebuild it. Insert and
+ * delete in the middle update positions of the items on the shorter
+ * side, i.e. cost is O(min(pos, used - pos)) as with the data move.
+ *
+ * If index can not be grown or rebuilt (allocation failure), it is
+ * detached, and searches fall back to scanning (see: po_is_indexed()).
+ *
+ * If "hash" and "equal" are NULL, items are indexed by identity
+ * (address). "equal" returns non-zero for equal items (as with
+ * po_find_with()). Index is released with po_release() (or
+ * po_destroy()), and po_destroy_storage() only empties it.
+ *
+ * @param po    Postor.
+ * @param hash  Hash function (or NULL).
+ * @param equal Equal function (or NULL).
+ *
+ * @return 1 on success (0 on allocation failure).
+ */
+int po_index_attach( po_t po, po_hash_fn_p hash, po_compare_fn_p equal );
+
+
+/**
+ * Return true if Postor has hash index.
+ *
+ * @param po Postor.
+ *
+ * @return 1 if indexed (else 0).
+ */
+int po_is_indexed( po_t po );
+
+
+/**
+ * Detach (and release) hash index from Postor.
+ *
+ * @param po Postor.
+ */
+void po_index_detach( po_t po );
+
+
+/**
+ * Find item using hash index.
+ *
+ * Falls back to po_find() if Postor has no index.
+ *
+ * @param po  Postor.
+ * @param ref Item to find.
+ *
+ * @return Lowest item index (or PO_NOT_INDEX).
+ */
+po_pos_t po_index_find( po_t po, po_d ref );
+
+
+/**
+ * Visit all items.
+ *
+ * Items are visited in order, and pointees are prefetched
+ * PO_PREFETCH_DIST items ahead, i.e. dereferencing items in "fn" is
+ * not stalled by cache misses. Unlike po_each(), NULL items are
+ * visited (and not prefetched).
+ *
+ * Postor must not be modified during visit.
+ *
+ * @param po    Postor.
+ * @param fn    Visit function.
+ * @param state State for visit function.
+ */
+void po_visit( po_t po, po_visit_fn_p fn, po_d state );
+
+
+/**
+ * Visit items in range (see: po_visit).
+ *
+ * Range is clipped to Postor usage.
+ *
+ * @param po    Postor.
+ * @param start Start index.
+ * @param end   End index (exclusive).
+ * @param fn    Visit function.
+ * @param state State for visit function.
+ */
+void po_visit_range( po_t po, po_size_t start, po_size_t end, po_visit_fn_p fn, po_d state );
+
+
 /**
  * Set Postor as local.
  *
@@ -629,6 +2134,38 @@ int po_get_local( po_t po );
  */
 
 
+/**
+ * Get Postor statistics.
+ *
+ * Statistics are collected when library is compiled with
+ * POSTOR_USE_STATS. Counters are updated atomically, i.e. statistics
+ * are thread-safe. Without POSTOR_USE_STATS statistics are zero.
+ *
+ * @param stats Statistics (output).
+ */
+void po_stats_get( po_stats_s* stats );
+
+
+/**
+ * Reset Postor statistics.
+ */
+void po_stats_reset( void );
+
+
+/**
+ * Release pooled storage blocks to system.
+ *
+ * With POSTOR_USE_POOL, storage of Postors (up to PO_POOL_MAX items)
+ * is recycled through size class pool, which has a cache per thread
+ * and a global depot. This function releases the blocks in the
+ * calling thread's cache and in the depot. Heap descriptors are
+ * allocated from per thread slabs. Slabs are not released, i.e. their
+ * memory is bounded by peak count of heap descriptors. Without
+ * POSTOR_USE_POOL this is a no-op.
+ */
+void po_pool_trim( void );
+
+
 /**
  * Allocate number of pages of memory.
  *
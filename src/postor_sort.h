@@ -0,0 +1,280 @@
+#ifndef POSTOR_SORT_H
+#define POSTOR_SORT_H
+
+/**
+ * @file   postor_sort.h
+ * @author Tero Isannainen <tero.isannainen@gmail.com>
+ * @date   Sun Jan  8 15:32:51 2023
+ *
+ * @brief  Postor - Pointer specialized sort template.
+ *
+ * Pattern-defeating quicksort (pdqsort) for po_d arrays. The sort is
+ * generated with po_sort_define() for a "less" operation, which is
+ * inlined into the sort, i.e. there is no callback per comparison.
+ *
+ *     #define ts_less( ctx, a, b ) ( ((ev_t*)(a))->ts < ((ev_t*)(b))->ts )
+ *     po_sort_define( ev_sort, void*, ts_less )
+ *     ...
+ *     ev_sort( po_data( po ), po_used( po ), NULL );
+ *
+ * "less" gets context and two items (values), and returns non-zero
+ * if first item is less than second. Sort is not stable.
+ */
+
+#include "postor.h"
+
+
+/** @cond postor_none */
+
+#define po_sort_insertion_limit 24
+#define po_sort_ninther_limit   128
+#define po_sort_partial_limit   8
+
+#define po_sort_swap( a, b )                    \
+    do {                                        \
+        po_d po_sort_tmp = ( a );               \
+        ( a ) = ( b );                          \
+        ( b ) = po_sort_tmp;                    \
+    } while ( 0 )
+
+/** @endcond postor_none */
+
+
+/**
+ * Define sort function "name" for "less" operation.
+ *
+ * Generated function:
+ *
+ *     static void name( po_d* data, po_size_t n, ctx_t ctx );
+ *
+ * @param name  Sort function name.
+ * @param ctx_t Type of context for "less".
+ * @param less  Less operation: less( ctx, a, b ).
+ */
+#define po_sort_define( name, ctx_t, less )                             \
+                                                                        \
+    static inline int name##_lt( ctx_t ctx, po_d a, po_d b )            \
+    {                                                                   \
+        (void)ctx;                                                      \
+        return ( less( ctx, a, b ) ) != 0;                              \
+    }                                                                   \
+                                                                        \
+    static inline void name##_sort2( po_d* a, po_d* b, ctx_t ctx )      \
+    {                                                                   \
+        if ( name##_lt( ctx, *b, *a ) ) {                               \
+            po_sort_swap( *a, *b );                                     \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    static inline void name##_sort3( po_d* a, po_d* b, po_d* c, ctx_t ctx ) \
+    {                                                                   \
+        name##_sort2( a, b, ctx );                                      \
+        name##_sort2( b, c, ctx );                                      \
+        name##_sort2( a, b, ctx );                                      \
+    }                                                                   \
+                                                                        \
+    /* Insertion sort, "unguarded" requires *(b-1) <= items. */         \
+    static void name##_insertion( po_d* b, po_d* e, ctx_t ctx, int guarded ) \
+    {                                                                   \
+        if ( b == e ) {                                                 \
+            return;                                                     \
+        }                                                               \
+        for ( po_d* cur = b + 1; cur != e; cur++ ) {                    \
+            po_d* sift = cur;                                           \
+            po_d* sift_1 = cur - 1;                                     \
+            if ( name##_lt( ctx, *sift, *sift_1 ) ) {                   \
+                po_d tmp = *sift;                                       \
+                do {                                                    \
+                    *sift-- = *sift_1;                                  \
+                } while ( ( !guarded || sift != b )                     \
+                          && name##_lt( ctx, tmp, *--sift_1 ) );        \
+                *sift = tmp;                                            \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    /* Insertion sort that gives up after limited number of moves. */  \
+    static int name##_partial( po_d* b, po_d* e, ctx_t ctx )            \
+    {                                                                   \
+        po_size_t limit = 0;                                            \
+        if ( b == e ) {                                                 \
+            return 1;                                                   \
+        }                                                               \
+        for ( po_d* cur = b + 1; cur != e; cur++ ) {                    \
+            po_d* sift = cur;                                           \
+            po_d* sift_1 = cur - 1;                                     \
+            if ( name##_lt( ctx, *sift, *sift_1 ) ) {                   \
+                po_d tmp = *sift;                                       \
+                do {                                                    \
+                    *sift-- = *sift_1;                                  \
+                } while ( sift != b && name##_lt( ctx, tmp, *--sift_1 ) ); \
+                *sift = tmp;                                            \
+                limit += cur - sift;                                    \
+                if ( limit > po_sort_partial_limit ) {                  \
+                    return 0;                                           \
+                }                                                       \
+            }                                                           \
+        }                                                               \
+        return 1;                                                       \
+    }                                                                   \
+                                                                        \
+    static void name##_sift( po_d* b, po_size_t root, po_size_t n, ctx_t ctx ) \
+    {                                                                   \
+        po_d tmp = b[ root ];                                           \
+        for ( ;; ) {                                                    \
+            po_size_t child = 2 * root + 1;                             \
+            if ( child >= n ) {                                         \
+                break;                                                  \
+            }                                                           \
+            if ( child + 1 < n && name##_lt( ctx, b[ child ], b[ child + 1 ] ) ) { \
+                child++;                                                \
+            }                                                           \
+            if ( !name##_lt( ctx, tmp, b[ child ] ) ) {                 \
+                break;                                                  \
+            }                                                           \
+            b[ root ] = b[ child ];                                     \
+            root = child;                                               \
+        }                                                               \
+        b[ root ] = tmp;                                                \
+    }                                                                   \
+                                                                        \
+    static void name##_heapsort( po_d* b, po_d* e, ctx_t ctx )          \
+    {                                                                   \
+        po_size_t n = e - b;                                            \
+        for ( po_size_t i = n / 2; i-- > 0; ) {                         \
+            name##_sift( b, i, n, ctx );                                \
+        }                                                               \
+        for ( po_size_t i = n - 1; i > 0; i-- ) {                       \
+            po_sort_swap( b[ 0 ], b[ i ] );                             \
+            name##_sift( b, 0, i, ctx );                                \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    /* Partition with items equal to pivot going right. */              \
+    static po_d* name##_part_right( po_d* b, po_d* e, ctx_t ctx, int* done ) \
+    {                                                                   \
+        po_d  pivot = *b;                                               \
+        po_d* first = b;                                                \
+        po_d* last = e;                                                 \
+        while ( name##_lt( ctx, *++first, pivot ) )                     \
+            ;                                                           \
+        if ( first - 1 == b ) {                                         \
+            while ( first < last && !name##_lt( ctx, *--last, pivot ) ) \
+                ;                                                       \
+        } else {                                                        \
+            while ( !name##_lt( ctx, *--last, pivot ) )                 \
+                ;                                                       \
+        }                                                               \
+        *done = first >= last;                                          \
+        while ( first < last ) {                                        \
+            po_sort_swap( *first, *last );                              \
+            while ( name##_lt( ctx, *++first, pivot ) )                 \
+                ;                                                       \
+            while ( !name##_lt( ctx, *--last, pivot ) )                 \
+                ;                                                       \
+        }                                                               \
+        po_d* pivot_pos = first - 1;                                    \
+        *b = *pivot_pos;                                                \
+        *pivot_pos = pivot;                                             \
+        return pivot_pos;                                               \
+    }                                                                   \
+                                                                        \
+    /* Partition with items equal to pivot going left. */               \
+    static po_d* name##_part_left( po_d* b, po_d* e, ctx_t ctx )        \
+    {                                                                   \
+        po_d  pivot = *b;                                               \
+        po_d* first = b;                                                \
+        po_d* last = e;                                                 \
+        while ( name##_lt( ctx, pivot, *--last ) )                      \
+            ;                                                           \
+        if ( last + 1 == e ) {                                          \
+            while ( first < last && !name##_lt( ctx, pivot, *++first ) ) \
+                ;                                                       \
+        } else {                                                        \
+            while ( !name##_lt( ctx, pivot, *++first ) )                \
+                ;                                                       \
+        }                                                               \
+        while ( first < last ) {                                        \
+            po_sort_swap( *first, *last );                              \
+            while ( name##_lt( ctx, pivot, *--last ) )                  \
+                ;                                                       \
+            while ( !name##_lt( ctx, pivot, *++first ) )                \
+                ;                                                       \
+        }                                                               \
+        *b = *last;                                                     \
+        *last = pivot;                                                  \
+        return last;                                                    \
+    }                                                                   \
+                                                                        \
+    static void name##_loop( po_d* b, po_d* e, ctx_t ctx, int bad, int leftmost ) \
+    {                                                                   \
+        for ( ;; ) {                                                    \
+            po_size_t size = e - b;                                     \
+            if ( size < po_sort_insertion_limit ) {                     \
+                name##_insertion( b, e, ctx, leftmost );                \
+                return;                                                 \
+            }                                                           \
+                                                                        \
+            /* Pivot is median of 3, or pseudomedian of 9. */           \
+            po_size_t s2 = size / 2;                                    \
+            if ( size > po_sort_ninther_limit ) {                       \
+                name##_sort3( b, b + s2, e - 1, ctx );                  \
+                name##_sort3( b + 1, b + ( s2 - 1 ), e - 2, ctx );      \
+                name##_sort3( b + 2, b + ( s2 + 1 ), e - 3, ctx );      \
+                name##_sort3( b + ( s2 - 1 ), b + s2, b + ( s2 + 1 ), ctx ); \
+                po_sort_swap( *b, *( b + s2 ) );                        \
+            } else {                                                    \
+                name##_sort3( b + s2, b, e - 1, ctx );                  \
+            }                                                           \
+                                                                        \
+            /* Predecessor equals pivot: skip all equal items. */       \
+            if ( !leftmost && !name##_lt( ctx, *( b - 1 ), *b ) ) {     \
+                b = name##_part_left( b, e, ctx ) + 1;                  \
+                continue;                                               \
+            }                                                           \
+                                                                        \
+            int       done;                                             \
+            po_d*     pivot_pos = name##_part_right( b, e, ctx, &done ); \
+            po_size_t l_size = pivot_pos - b;                           \
+            po_size_t r_size = e - ( pivot_pos + 1 );                   \
+                                                                        \
+            if ( l_size < size / 8 || r_size < size / 8 ) {             \
+                /* Bad partition: fall back or break patterns. */       \
+                if ( --bad == 0 ) {                                     \
+                    name##_heapsort( b, e, ctx );                       \
+                    return;                                             \
+                }                                                       \
+                if ( l_size >= po_sort_insertion_limit ) {              \
+                    po_sort_swap( b[ 0 ], b[ l_size / 4 ] );            \
+                    po_sort_swap( pivot_pos[ -1 ], *( pivot_pos - l_size / 4 ) ); \
+                }                                                       \
+                if ( r_size >= po_sort_insertion_limit ) {              \
+                    po_sort_swap( pivot_pos[ 1 ], pivot_pos[ 1 + r_size / 4 ] ); \
+                    po_sort_swap( e[ -1 ], *( e - r_size / 4 ) );       \
+                }                                                       \
+            } else if ( done && name##_partial( b, pivot_pos, ctx )     \
+                        && name##_partial( pivot_pos + 1, e, ctx ) ) {  \
+                /* Already partitioned and nearly sorted. */            \
+                return;                                                 \
+            }                                                           \
+                                                                        \
+            name##_loop( b, pivot_pos, ctx, bad, leftmost );            \
+            b = pivot_pos + 1;                                          \
+            leftmost = 0;                                               \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    static void name( po_d* data, po_size_t n, ctx_t ctx )              \
+    {                                                                   \
+        int bad = 1;                                                    \
+        if ( n < 2 ) {                                                  \
+            return;                                                     \
+        }                                                               \
+        for ( po_size_t i = n; i > 1; i >>= 1 ) {                       \
+            bad++;                                                      \
+        }                                                               \
+        name##_loop( data, data + n, ctx, bad, 1 );                     \
+    }
+
+
+#endif
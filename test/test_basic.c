@@ -1,7 +1,10 @@
 #include "unity.h"
 #include "postor.h"
+#include "postor_sort.h"
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 
 void gdb_breakpoint( void ) {}
 
@@ -250,6 +253,8 @@ void test_static( void )
     po_push( po, str2 );
 
     TEST_ASSERT_FALSE( po_get_local( po ) );
+    TEST_ASSERT_EQUAL_STRING( po_item( po, 0, char* ), str1 );
+    TEST_ASSERT_EQUAL_STRING( po_item( po, 9, char* ), str2 );
 
     po_destroy_storage( po );
 
@@ -258,6 +263,43 @@ void test_static( void )
 }
 
 
+po_inline_type( po_test_kids_t, 3 );
+
+void test_inline( void )
+{
+    po_test_kids_t kids;
+
+
+    TEST_ASSERT_TRUE( sizeof( kids.buf ) == 4 * sizeof( po_d ) );
+
+    po_inline_init( &kids );
+    TEST_ASSERT_TRUE( po_get_local( &kids.po ) );
+    TEST_ASSERT_TRUE( po_is_empty( &kids.po ) );
+
+    for ( po_size_t i = 0; i < 4; i++ ) {
+        po_push( &kids.po, (po_d)( i + 1 ) );
+    }
+    TEST_ASSERT_TRUE( po_data( &kids.po ) == kids.buf );
+
+    /* Spill to heap. */
+    po_push( &kids.po, (po_d)5 );
+    TEST_ASSERT_FALSE( po_get_local( &kids.po ) );
+    TEST_ASSERT_TRUE( po_data( &kids.po ) != kids.buf );
+    for ( po_size_t i = 0; i < 5; i++ ) {
+        TEST_ASSERT_TRUE( po_nth( &kids.po, i ) == (po_d)( i + 1 ) );
+    }
+    po_destroy_storage( &kids.po );
+
+    /* Front push spills too. */
+    po_inline_init( &kids );
+    po_push( &kids.po, (po_d)2 );
+    po_push_front( &kids.po, (po_d)1 );
+    TEST_ASSERT_TRUE( po_first( &kids.po ) == (po_d)1 );
+    TEST_ASSERT_TRUE( po_last( &kids.po ) == (po_d)2 );
+    po_destroy_storage( &kids.po );
+}
+
+
 
 void test_alloc( void )
 {
@@ -300,3 +342,1629 @@ void test_alloc( void )
     TEST_ASSERT_TRUE( po_bytesize( po ) == page_size );
     po_destroy_storage( po );
 }
+
+
+void test_arena( void )
+{
+    po_s      ps;
+    po_t      po;
+    po_d      pd;
+    po_d      first;
+    po_d      big;
+    po_size_t page_size;
+    po_mark_s mark;
+
+
+    page_size = po_alloc_pages( 0, NULL );
+
+    po = po_new_arena( &ps, 1 );
+    TEST_ASSERT_TRUE( po_bytesize( po ) == page_size );
+
+    first = po_alloc_bytes( po, page_size - 8 );
+    TEST_ASSERT_TRUE( first != NULL );
+    memset( first, 0xAB, page_size - 8 );
+
+    /* Chain new block, first block stays in place. */
+    mark = po_arena_mark( po );
+    pd = po_alloc_bytes( po, 16 );
+    TEST_ASSERT_TRUE( pd != NULL );
+    TEST_ASSERT_TRUE( po->used == 2 );
+    TEST_ASSERT_TRUE( ( (uint8_t*)first )[ 0 ] == 0xAB );
+
+    /* Allocation larger than block. */
+    big = po_alloc_bytes( po, 3 * page_size );
+    TEST_ASSERT_TRUE( big != NULL );
+    TEST_ASSERT_TRUE( po_bytesize( po ) == 3 * page_size );
+    memset( big, 0xCD, 3 * page_size );
+
+    /* Rewind clears released memory in first block. */
+    po_arena_rewind( po, mark );
+    TEST_ASSERT_TRUE( po->used == mark.used );
+    TEST_ASSERT_TRUE( po_bytesize( po ) == page_size );
+    TEST_ASSERT_TRUE( po_data( po ) == first );
+    pd = po_alloc_bytes( po, 8 );
+    TEST_ASSERT_TRUE( pd != NULL );
+#ifndef POSTOR_NO_CLEAR
+    TEST_ASSERT_TRUE( *(po_d*)pd == NULL );
+#endif
+
+    po_alloc_bytes( po, 2 * page_size );
+    po_arena_release( po );
+    TEST_ASSERT_TRUE( po->used == 0 );
+    TEST_ASSERT_TRUE( po_data( po ) == first );
+#ifndef POSTOR_NO_CLEAR
+    TEST_ASSERT_TRUE( ( (uint8_t*)first )[ 0 ] == 0 );
+#endif
+
+    po_alloc_bytes( po, 2 * page_size );
+    po_destroy_storage( po );
+
+    /* Many retired blocks. */
+    po = po_new_arena( &ps, 1 );
+    first = po_data( po );
+    mark = po_arena_mark( po );
+    for ( int i = 0; i < 20; i++ ) {
+        TEST_ASSERT_TRUE( po_alloc_bytes( po, page_size ) != NULL );
+    }
+    TEST_ASSERT_TRUE( po_arena_mark( po ).block == 19 );
+    po_arena_rewind( po, mark );
+    TEST_ASSERT_TRUE( po_data( po ) == first );
+    TEST_ASSERT_TRUE( po->used == 0 );
+    po_destroy_storage( po );
+
+    /* Aligned allocations. */
+    po = po_new_arena( &ps, 1 );
+    po_alloc_bytes( po, 1 );
+    pd = po_alloc_aligned( po, 10, 64 );
+    TEST_ASSERT_TRUE( ( (uintptr_t)pd % 64 ) == 0 );
+    TEST_ASSERT_TRUE( po->used == 10 );
+    pd = po_alloc_aligned( po, 1, 1 );
+    TEST_ASSERT_TRUE( pd == &po->data[ 10 ] );
+    pd = po_alloc_array( po, 3, sizeof( double ), 32 );
+    TEST_ASSERT_TRUE( ( (uintptr_t)pd % 32 ) == 0 );
+    TEST_ASSERT_TRUE( po->used == 15 );
+    TEST_ASSERT_TRUE( po_alloc_array( po, UINT64_MAX, 2, 8 ) == NULL );
+    TEST_ASSERT_TRUE( po->used == 15 );
+    first = po_data( po );
+    pd = po_alloc_array( po, page_size / 64, 64, 128 );
+    TEST_ASSERT_TRUE( pd != NULL && po_data( po ) != first );
+    TEST_ASSERT_TRUE( ( (uintptr_t)pd % 128 ) == 0 );
+    po_destroy_storage( po );
+
+    /* Plain Paged Postor does not chain. */
+    po = po_new_pages( &ps, 1 );
+    TEST_ASSERT_TRUE( po_alloc_bytes( po, page_size + 8 ) == NULL );
+    po_alloc_bytes( po, page_size - 56 );
+    TEST_ASSERT_TRUE( po_alloc_aligned( po, 8, 64 ) == NULL );
+    TEST_ASSERT_TRUE( po_alloc_aligned( po, 8, 16 ) != NULL );
+    po_destroy_storage( po );
+}
+
+
+void test_mapped( void )
+{
+    po_s      ps;
+    po_t      po;
+    po_d*     data;
+    po_size_t i;
+
+
+    po = po_new_mapped( &ps, 16, 4096, 0 );
+    TEST_ASSERT_TRUE( po_size( po ) == 16 );
+
+    /* Growth within reservation does not move. */
+    data = po_data( po );
+    for ( i = 0; i < 4000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+#ifndef POSTOR_NO_MMAP
+    TEST_ASSERT_TRUE( po_data( po ) == data );
+#else
+    (void)data;
+#endif
+
+    /* Growth beyond reservation keeps items. */
+    for ( ; i < 100000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    for ( i = 0; i < 100000; i++ ) {
+        TEST_ASSERT_TRUE( po_nth( po, i ) == (po_d)( i + 1 ) );
+    }
+
+    /* Shrink and grow: memory after usage is cleared. */
+    for ( i = 0; i < 99000; i++ ) {
+        po_pop( po );
+    }
+    po_resize( po, 1000 );
+    TEST_ASSERT_TRUE( po_size( po ) == 1000 );
+    po_resize( po, 200000 );
+    TEST_ASSERT_TRUE( po_nth( po, 999 ) == (po_d)1000 );
+    for ( i = 1000; i < 200000; i += 511 ) {
+        TEST_ASSERT_TRUE( po_data( po )[ i ] == NULL );
+    }
+
+    po_push_front( po, (po_d)1 );
+    TEST_ASSERT_TRUE( po_first( po ) == (po_d)1 );
+    TEST_ASSERT_TRUE( po_last( po ) == (po_d)1000 );
+    po_destroy_storage( po );
+
+    /* Huge pages fall back to normal pages. */
+    po = po_new_mapped( NULL, 0, 0, PO_MAP_HUGETLB | PO_MAP_THP );
+    for ( i = 0; i < 10000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    TEST_ASSERT_TRUE( po_used( po ) == 10000 );
+    TEST_ASSERT_TRUE( po_last( po ) == (po_d)10000 );
+    po_destroy( po );
+}
+
+
+po_size_t po_test_resize_fn( po_t po, po_size_t new_size, po_d state )
+{
+    ( *(int*)state )++;
+    return po_size( po ) + new_size + 10;
+}
+
+
+void test_growth( void )
+{
+    po_s ps;
+    po_t po;
+    char* text = "text";
+    int   calls = 0;
+
+    po = po_new_sized( &ps, 8 );
+    TEST_ASSERT_EQUAL( PO_GROW_DOUBLE, po_get_growth( po ) );
+
+    TEST_ASSERT_TRUE( po_set_growth( po, PO_GROW_HALF, 0 ) );
+    TEST_ASSERT_EQUAL( PO_GROW_HALF, po_get_growth( po ) );
+    for ( int i = 0; i < 9; i++ ) {
+        po_push( po, text );
+    }
+    TEST_ASSERT_EQUAL( 12, po_size( po ) );
+
+    TEST_ASSERT_TRUE( po_set_growth( po, PO_GROW_STEP, 6 ) );
+    for ( int i = 0; i < 4; i++ ) {
+        po_insert_at( po, 0, text );
+    }
+    TEST_ASSERT_EQUAL( 18, po_size( po ) );
+    TEST_ASSERT_EQUAL( 13, po_used( po ) );
+
+    TEST_ASSERT_FALSE( po_set_growth( po, PO_GROW_FN, 0 ) );
+    TEST_ASSERT_FALSE( po_set_resize_fn( po, NULL, NULL ) );
+    TEST_ASSERT_EQUAL( PO_GROW_STEP, po_get_growth( po ) );
+    TEST_ASSERT_TRUE( po_set_resize_fn( po, po_test_resize_fn, &calls ) );
+    TEST_ASSERT_EQUAL( PO_GROW_FN, po_get_growth( po ) );
+    for ( int i = 0; i < 6; i++ ) {
+        po_push( po, text );
+    }
+    TEST_ASSERT_EQUAL( 1, calls );
+    TEST_ASSERT_EQUAL( 18 + 19 + 10 + 1, po_size( po ) );
+
+    /* Resize function is also consulted by explicit resize. */
+    po_resize( po, 20 );
+    TEST_ASSERT_EQUAL( 2, calls );
+    TEST_ASSERT_EQUAL( 48 + 20 + 10, po_size( po ) );
+
+    /* Duplicate inherits policy. */
+    po_s dup = po_duplicate( po );
+    TEST_ASSERT_EQUAL( PO_GROW_FN, po_get_growth( &dup ) );
+    po_release( &dup );
+
+    /* Policy is kept over storage destruction. */
+    po_destroy_storage( po );
+    TEST_ASSERT_EQUAL( PO_GROW_FN, po_get_growth( po ) );
+    po_release( po );
+    TEST_ASSERT_EQUAL( NULL, po->ext );
+
+    /* Policy is preserved when po_add creates the container. */
+    po_new_descriptor( po );
+    po_set_growth( po, PO_GROW_STEP, 2 );
+    for ( int i = 0; i < PO_DEFAULT_SIZE + 1; i++ ) {
+        po_add( po, text );
+    }
+    TEST_ASSERT_EQUAL( PO_DEFAULT_SIZE + 2, po_size( po ) );
+
+    /* Policy is kept when po_remove empties the container. */
+    while ( po_remove( po ) )
+        ;
+    TEST_ASSERT_EQUAL( NULL, po->data );
+    TEST_ASSERT_EQUAL( PO_GROW_STEP, po_get_growth( po ) );
+    for ( int i = 0; i < PO_DEFAULT_SIZE + 1; i++ ) {
+        po_add( po, text );
+    }
+    TEST_ASSERT_EQUAL( PO_DEFAULT_SIZE + 2, po_size( po ) );
+    po_release( po );
+}
+
+
+void test_clear( void )
+{
+    po_s      ps;
+    po_t      po;
+    po_size_t i;
+
+
+    po = po_new_sized( &ps, 4 );
+    TEST_ASSERT_TRUE( po_set_clear( po, 0 ) );
+    for ( i = 0; i < 1000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    for ( i = 0; i < 1000; i++ ) {
+        TEST_ASSERT_TRUE( po_nth( po, i ) == (po_d)( i + 1 ) );
+    }
+    po_push_front( po, (po_d)1 );
+    TEST_ASSERT_TRUE( po_used( po ) == 1001 );
+    TEST_ASSERT_TRUE( po_last( po ) == (po_d)1000 );
+
+    /* Only used slots are cleared. */
+    po_pop_front( po );
+    po_clear_used( po );
+    TEST_ASSERT_TRUE( po_used( po ) == 0 );
+    for ( i = 0; i < 1000; i++ ) {
+        TEST_ASSERT_TRUE( po_data( po )[ i ] == NULL );
+    }
+
+    po_push( po, (po_d)1 );
+    TEST_ASSERT_TRUE( po_set_clear( po, 1 ) );
+    po_resize( po, 4096 );
+#ifndef POSTOR_NO_CLEAR
+    TEST_ASSERT_TRUE( po_data( po )[ 4095 ] == NULL );
+#endif
+    po_destroy_storage( po );
+
+    po_new_descriptor( po );
+    po_clear_used( po );
+    TEST_ASSERT_TRUE( po_used( po ) == 0 );
+}
+
+
+void test_shrink( void )
+{
+    po_s      ps;
+    po_t      po;
+    po_size_t i;
+
+
+    po = po_new( &ps );
+    for ( i = 0; i < 1000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    TEST_ASSERT_TRUE( po_size( po ) == 1024 );
+    po_drop( po, 900 );
+    po_shrink_to_fit( po );
+    TEST_ASSERT_TRUE( po_size( po ) == 100 );
+    TEST_ASSERT_TRUE( po_last( po ) == (po_d)100 );
+
+    /* Automatic shrink with hysteresis. */
+    TEST_ASSERT_TRUE( po_set_shrink( po, 1 ) );
+    for ( i = 100; i < 1000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    TEST_ASSERT_TRUE( po_size( po ) == 1600 );
+    while ( po_used( po ) >= 400 ) {
+        po_pop( po );
+    }
+    TEST_ASSERT_TRUE( po_size( po ) == 800 );
+    po_push( po, (po_d)1 );
+    po_pop( po );
+    TEST_ASSERT_TRUE( po_size( po ) == 800 );
+    po_delete_range( po, 0, 300 );
+    TEST_ASSERT_TRUE( po_size( po ) == 200 );
+    TEST_ASSERT_TRUE( po_first( po ) == (po_d)301 );
+    TEST_ASSERT_TRUE( po_last( po ) == (po_d)399 );
+    po_pop_front( po );
+    po_delete_at( po, 0 );
+    po_delete_unordered( po, 0 );
+    TEST_ASSERT_TRUE( po_first( po ) == (po_d)399 );
+    po_reset( po );
+    TEST_ASSERT_TRUE( po_size( po ) < 2 * PO_DEFAULT_SIZE );
+    po_release( po );
+
+    /* Mapped storage returns memory. */
+    po = po_new_mapped( &ps, 0, 0, 0 );
+    po_set_shrink( po, 1 );
+    for ( i = 0; i < 100000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    po_drop( po, 99990 );
+    TEST_ASSERT_TRUE( po_size( po ) < 100 );
+    for ( i = 0; i < 100000; i++ ) {
+        po_push( po, NULL );
+    }
+    TEST_ASSERT_TRUE( po_nth( po, 9 ) == (po_d)10 );
+    TEST_ASSERT_TRUE( po_data( po )[ 10 ] == NULL );
+    po_release( po );
+
+    /* Local storage is not shrunk. */
+    po_use_local( ls, buf, 64 );
+    po_set_shrink( &ls, 1 );
+    po_push( &ls, (po_d)1 );
+    po_pop( &ls );
+    po_shrink_to_fit( &ls );
+    TEST_ASSERT_TRUE( po_size( &ls ) == 64 );
+    po_release( &ls );
+}
+
+
+void test_bulk( void )
+{
+    po_s      ps;
+    po_s      os;
+    po_t      po;
+    po_d      items[ 40 ];
+    po_size_t i;
+
+    for ( i = 0; i < 40; i++ ) {
+        items[ i ] = (po_d)( i + 1 );
+    }
+
+    po = po_new_sized( &ps, 4 );
+    po_push_n( po, items, 3 );
+    TEST_ASSERT_EQUAL( 3, po_used( po ) );
+    TEST_ASSERT_EQUAL( 4, po_size( po ) );
+
+    /* Single resize fits everything. */
+    po_push_n( po, &items[ 3 ], 37 );
+    TEST_ASSERT_EQUAL( 40, po_used( po ) );
+    TEST_ASSERT_EQUAL( 40, po_size( po ) );
+    for ( i = 0; i < 40; i++ ) {
+        TEST_ASSERT_EQUAL( items[ i ], po_nth( po, i ) );
+    }
+
+    po_push_n( po, items, 0 );
+    TEST_ASSERT_EQUAL( 40, po_used( po ) );
+
+    /* Own items, storage moves on growth. */
+    po_new_sized( &os, 4 );
+    po_push_n( &os, items, 4 );
+    po_push_n( &os, po_data( &os ) + 1, 3 );
+    po_push_n( &os, po_data( &os ), 7 );
+    TEST_ASSERT_EQUAL( 14, po_used( &os ) );
+    TEST_ASSERT_EQUAL( items[ 1 ], po_nth( &os, 4 ) );
+    TEST_ASSERT_EQUAL( items[ 3 ], po_nth( &os, 6 ) );
+    TEST_ASSERT_EQUAL( items[ 0 ], po_nth( &os, 7 ) );
+    TEST_ASSERT_EQUAL( items[ 3 ], po_last( &os ) );
+    po_append_postor( &os, &os );
+    TEST_ASSERT_EQUAL( 28, po_used( &os ) );
+    TEST_ASSERT_EQUAL( items[ 0 ], po_nth( &os, 14 ) );
+    po_destroy_storage( &os );
+
+    po_new_sized( &os, 4 );
+    po_push_n( &os, items, 2 );
+    po_insert_n_at( &os, 1, &items[ 10 ], 3 );
+    TEST_ASSERT_EQUAL( 5, po_used( &os ) );
+    TEST_ASSERT_EQUAL( items[ 0 ], po_nth( &os, 0 ) );
+    TEST_ASSERT_EQUAL( items[ 10 ], po_nth( &os, 1 ) );
+    TEST_ASSERT_EQUAL( items[ 12 ], po_nth( &os, 3 ) );
+    TEST_ASSERT_EQUAL( items[ 1 ], po_nth( &os, 4 ) );
+
+    po_insert_n_at( &os, po_used( &os ), &items[ 20 ], 2 );
+    TEST_ASSERT_EQUAL( items[ 21 ], po_last( &os ) );
+    po_insert_n_at( &os, -1, &items[ 30 ], 1 );
+    TEST_ASSERT_EQUAL( items[ 30 ], po_nth( &os, -2 ) );
+    TEST_ASSERT_EQUAL( 8, po_used( &os ) );
+
+    po_append_postor( po, &os );
+    TEST_ASSERT_EQUAL( 48, po_used( po ) );
+    TEST_ASSERT_EQUAL( items[ 21 ], po_last( po ) );
+
+    po_append_postor( &os, &os );
+    TEST_ASSERT_EQUAL( 16, po_used( &os ) );
+    TEST_ASSERT_EQUAL( items[ 0 ], po_nth( &os, 8 ) );
+
+    po_destroy_storage( &os );
+    po_destroy_storage( po );
+}
+
+
+int po_test_is_odd( const po_d item, po_d state )
+{
+    ( *(int*)state )++;
+    return ( (uintptr_t)item & 1 );
+}
+
+
+void test_delete_range( void )
+{
+    po_s      ps;
+    po_t      po;
+    int       calls = 0;
+    po_size_t i;
+
+    po = po_new( &ps );
+    for ( i = 0; i < 20; i++ ) {
+        po_push( po, (po_d)i );
+    }
+
+    TEST_ASSERT_EQUAL( 3, po_delete_range( po, 2, 3 ) );
+    TEST_ASSERT_EQUAL( 17, po_used( po ) );
+    TEST_ASSERT_EQUAL( 1, po_nth( po, 1 ) );
+    TEST_ASSERT_EQUAL( 5, po_nth( po, 2 ) );
+
+    /* Range is limited to end. */
+    TEST_ASSERT_EQUAL( 2, po_delete_range( po, -2, 10 ) );
+    TEST_ASSERT_EQUAL( 17, po_last( po ) );
+    TEST_ASSERT_EQUAL( 0, po_delete_range( po, 0, 0 ) );
+
+    TEST_ASSERT_EQUAL( 8, po_remove_if( po, po_test_is_odd, &calls ) );
+    TEST_ASSERT_EQUAL( 15, calls );
+    TEST_ASSERT_EQUAL( 7, po_used( po ) );
+    for ( i = 0; i < po_used( po ); i++ ) {
+        TEST_ASSERT_EQUAL( 0, (uintptr_t)po_nth( po, i ) & 1 );
+    }
+    TEST_ASSERT_EQUAL( 0, po_nth( po, 0 ) );
+    TEST_ASSERT_EQUAL( 16, po_last( po ) );
+
+    /* Keep odd, i.e. delete all. */
+    TEST_ASSERT_EQUAL( 7, po_filter( po, po_test_is_odd, &calls ) );
+    TEST_ASSERT_EQUAL( 0, po_used( po ) );
+    TEST_ASSERT_EQUAL( 0, po_delete_range( po, 0, 1 ) );
+
+    po_push( po, (po_d)3 );
+    po_push( po, (po_d)5 );
+    TEST_ASSERT_EQUAL( 0, po_filter( po, po_test_is_odd, &calls ) );
+    TEST_ASSERT_EQUAL( 2, po_delete_range( po, 0, 2 ) );
+    TEST_ASSERT_EQUAL( NULL, po_first( po ) );
+
+    po_destroy_storage( po );
+}
+
+
+void test_find( void )
+{
+    po_s      ps;
+    po_t      po;
+    po_size_t i;
+    po_d      a = (po_d)0x1000;
+    po_d      b = (po_d)0x100000002000;
+
+    po = po_new( &ps );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find_last( po, a ) );
+    TEST_ASSERT_EQUAL( 0, po_count( po, a ) );
+
+    /* Cover vector steps and scalar tails with all lengths. */
+    for ( po_size_t n = 1; n < 40; n++ ) {
+        po_reset( po );
+        for ( i = 0; i < n; i++ ) {
+            po_push( po, (po_d)( 0x2000 + i ) );
+        }
+        TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, a ) );
+        TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, b ) );
+
+        for ( i = 0; i < n; i++ ) {
+            po_d save = po_swap( po, i, a );
+            TEST_ASSERT_EQUAL( i, po_find( po, a ) );
+            TEST_ASSERT_EQUAL( i, po_find_last( po, a ) );
+            TEST_ASSERT_EQUAL( 1, po_count( po, a ) );
+            po_swap( po, i, save );
+        }
+
+        /* Only one 32-bit half matches. */
+        po_swap( po, 0, (po_d)0x100000001000 );
+        TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, a ) );
+        TEST_ASSERT_EQUAL( 0, po_count( po, a ) );
+
+        po_swap( po, 0, a );
+        po_swap( po, -1, a );
+        TEST_ASSERT_EQUAL( 0, po_find( po, a ) );
+        TEST_ASSERT_EQUAL( n - 1, po_find_last( po, a ) );
+        TEST_ASSERT_EQUAL( ( n > 1 ) ? 2 : 1, po_count( po, a ) );
+    }
+
+    po_destroy_storage( po );
+}
+
+
+void test_sorted( void )
+{
+    po_s  ps;
+    po_t  po;
+    char* strs[] = { "aaa", "ccc", "eee", "ggg" };
+    char* bbb = "bbb";
+    char* ccc = "ccc";
+    char* zzz = "zzz";
+    char* c2 = strdup( "ccc" );
+
+    po = po_new_sized( &ps, 2 );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_bsearch( po, po_sort_compare, ccc ) );
+    TEST_ASSERT_EQUAL( 0, po_lower_bound( po, po_sort_compare, ccc ) );
+
+    po_insert_sorted( po, po_sort_compare, strs[ 2 ] );
+    po_insert_sorted( po, po_sort_compare, strs[ 0 ] );
+    po_insert_sorted( po, po_sort_compare, strs[ 3 ] );
+    TEST_ASSERT_EQUAL( 1, po_insert_sorted( po, po_sort_compare, strs[ 1 ] ) );
+    for ( int i = 0; i < 4; i++ ) {
+        TEST_ASSERT_EQUAL( strs[ i ], po_nth( po, i ) );
+    }
+
+    TEST_ASSERT_EQUAL( 1, po_bsearch( po, po_sort_compare, ccc ) );
+    TEST_ASSERT_EQUAL( 3, po_bsearch( po, po_sort_compare, "ggg" ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_bsearch( po, po_sort_compare, bbb ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_bsearch( po, po_sort_compare, zzz ) );
+
+    /* Equal item goes after existing equal items. */
+    TEST_ASSERT_EQUAL( 2, po_insert_sorted( po, po_sort_compare, c2 ) );
+    TEST_ASSERT_EQUAL( c2, po_nth( po, 2 ) );
+    TEST_ASSERT_EQUAL( 1, po_lower_bound( po, po_sort_compare, ccc ) );
+    TEST_ASSERT_EQUAL( 3, po_upper_bound( po, po_sort_compare, ccc ) );
+    TEST_ASSERT_EQUAL( 1, po_bsearch( po, po_sort_compare, c2 ) );
+    TEST_ASSERT_EQUAL( 1, po_lower_bound( po, po_sort_compare, bbb ) );
+    TEST_ASSERT_EQUAL( 5, po_upper_bound( po, po_sort_compare, zzz ) );
+
+    po_destroy_storage( po );
+    free( c2 );
+}
+
+
+int po_test_ptr_compare( const po_d a, const po_d b )
+{
+    uintptr_t ia = *(uintptr_t*)a;
+    uintptr_t ib = *(uintptr_t*)b;
+
+    return ( ia > ib ) - ( ia < ib );
+}
+
+
+uint64_t po_test_ptr_key( const po_d item, po_d state )
+{
+    (void)state;
+    return (uint64_t)(uintptr_t)item >> 4;
+}
+
+
+#define po_test_rev_less( ctx, a, b ) ( (uintptr_t)( a ) > (uintptr_t)( b ) )
+po_sort_define( po_test_rev_sort, void*, po_test_rev_less )
+
+
+void test_sort_variants( void )
+{
+    po_t     po;
+    uint64_t seed = 1;
+    int      sizes[] = { 0, 1, 2, 23, 24, 100, 129, 1000, 20000 };
+
+    po = po_new( NULL );
+
+    for ( int s = 0; s < (int)( sizeof( sizes ) / sizeof( sizes[ 0 ] ) ); s++ ) {
+        int n = sizes[ s ];
+
+        /* Random, sorted, reverse, equal, and sawtooth inputs. */
+        for ( int pattern = 0; pattern < 5; pattern++ ) {
+            po_reset( po );
+            for ( int i = 0; i < n; i++ ) {
+                uintptr_t v;
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                switch ( pattern ) {
+                    case 0: v = ( seed >> 33 ) & 0xFFFF0; break;
+                    case 1: v = i << 4; break;
+                    case 2: v = ( n - i ) << 4; break;
+                    case 3: v = 0x50; break;
+                    default: v = ( i % 17 ) << 4; break;
+                }
+                po_push( po, (po_d)v );
+            }
+
+            po_sort( po, po_test_ptr_compare );
+            for ( int i = 1; i < n; i++ ) {
+                TEST_ASSERT( po_nth( po, i - 1 ) <= po_nth( po, i ) );
+            }
+
+            po_test_rev_sort( po_data( po ), po_used( po ), NULL );
+            for ( int i = 1; i < n; i++ ) {
+                TEST_ASSERT( po_nth( po, i - 1 ) >= po_nth( po, i ) );
+            }
+
+            TEST_ASSERT_TRUE( po_sort_by_key( po, po_test_ptr_key, NULL ) );
+            for ( int i = 1; i < n; i++ ) {
+                TEST_ASSERT( po_nth( po, i - 1 ) <= po_nth( po, i ) );
+            }
+        }
+    }
+
+    /* Key sort is stable. */
+    po_reset( po );
+    for ( uintptr_t i = 0; i < 64; i++ ) {
+        po_push( po, (po_d)( ( ( 63 - i ) & 0x30 ) | ( i & 0x0F ) ) );
+    }
+    po_sort_by_key( po, po_test_ptr_key, NULL );
+    for ( int i = 1; i < 64; i++ ) {
+        uintptr_t a = (uintptr_t)po_nth( po, i - 1 );
+        uintptr_t b = (uintptr_t)po_nth( po, i );
+        TEST_ASSERT( ( a >> 4 ) < ( b >> 4 ) || ( a & 0x0F ) < ( b & 0x0F ) );
+    }
+
+    po_destroy( po );
+}
+
+
+void test_parallel( void )
+{
+    po_t      po;
+    po_s      ref;
+    uint64_t  seed = 7;
+    po_size_t n = 16 * PO_PARALLEL_MIN + 123;
+
+    po = po_new( NULL );
+    for ( po_size_t i = 0; i < n; i++ ) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        po_push( po, (po_d)( ( seed >> 40 ) << 4 ) );
+    }
+    ref = po_duplicate( po );
+    po_sort( &ref, po_test_ptr_compare );
+
+    for ( po_size_t threads = 0; threads < 8; threads++ ) {
+        po_s dup = po_duplicate( po );
+        TEST_ASSERT_TRUE( po_sort_parallel( &dup, po_test_ptr_compare, threads ) );
+        TEST_ASSERT_EQUAL_MEMORY( po_data( &ref ), po_data( &dup ), n * sizeof( po_d ) );
+        po_destroy_storage( &dup );
+    }
+
+    /* Lowest index wins. */
+    po_d mark = (po_d)0x8;
+    po_swap( po, n - 1, mark );
+    TEST_ASSERT_EQUAL( n - 1, po_find_with_parallel( po, po_compare_fn, mark, 4 ) );
+    po_swap( po, n / 2, mark );
+    po_swap( po, n / 2 + 1, mark );
+    TEST_ASSERT_EQUAL( n / 2, po_find_with_parallel( po, po_compare_fn, mark, 4 ) );
+    po_swap( po, 10, mark );
+    TEST_ASSERT_EQUAL( 10, po_find_with_parallel( po, po_compare_fn, mark, 0 ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find_with_parallel( po, po_compare_fn, (po_d)0x4, 3 ) );
+
+    /* Small Postor is handled serially. */
+    po_s small;
+    po_new( &small );
+    po_push( &small, mark );
+    TEST_ASSERT_EQUAL( 0, po_find_with_parallel( &small, po_compare_fn, mark, 4 ) );
+    TEST_ASSERT_TRUE( po_sort_parallel( &small, po_test_ptr_compare, 4 ) );
+    po_destroy_storage( &small );
+
+    po_destroy_storage( &ref );
+    po_destroy( po );
+}
+
+
+uint64_t po_test_str_hash( const po_d item )
+{
+    uint64_t h = 5381;
+    for ( char* c = item; *c; c++ ) {
+        h = h * 33 + *c;
+    }
+    return h;
+}
+
+
+int po_test_str_equal( const po_d a, const po_d b )
+{
+    return strcmp( a, b ) == 0;
+}
+
+
+/* Check index against linear search for all items. */
+static void po_test_check_index( po_t po )
+{
+    for ( po_size_t i = 0; i < po_used( po ); i++ ) {
+        po_d item = po_nth( po, i );
+        TEST_ASSERT_EQUAL( po_find_with( po, po_compare_fn, item ), po_index_find( po, item ) );
+    }
+}
+
+
+void test_index( void )
+{
+    po_s      ps;
+    po_t      po;
+    po_size_t i;
+    po_d      items[ 64 ];
+    po_d      tmp;
+
+    for ( i = 0; i < 64; i++ ) {
+        items[ i ] = (po_d)( ( i + 1 ) << 4 );
+    }
+
+    po = po_new( &ps );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_index_find( po, items[ 0 ] ) );
+    po_push( po, items[ 0 ] );
+    TEST_ASSERT_TRUE( po_index_attach( po, NULL, NULL ) );
+    TEST_ASSERT_EQUAL( 0, po_index_find( po, items[ 0 ] ) );
+
+    /* Push enough to grow the index. */
+    for ( i = 1; i < 40; i++ ) {
+        po_push( po, items[ i ] );
+    }
+    po_test_check_index( po );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_index_find( po, items[ 50 ] ) );
+
+    TEST_ASSERT_EQUAL( items[ 39 ], po_pop( po ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, items[ 39 ] ) );
+
+    tmp = po_swap( po, 5, items[ 50 ] );
+    TEST_ASSERT_EQUAL( items[ 5 ], tmp );
+    TEST_ASSERT_EQUAL( 5, po_find( po, items[ 50 ] ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, items[ 5 ] ) );
+
+    po_insert_at( po, 3, items[ 51 ] );
+    po_insert_at( po, 0, items[ 52 ] );
+    po_test_check_index( po );
+    TEST_ASSERT_EQUAL( 4, po_find( po, items[ 51 ] ) );
+
+    po_delete_at( po, 2 );
+    po_delete_at( po, -1 );
+    po_test_check_index( po );
+
+    tmp = po_delete_unordered( po, 1 );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, tmp ) );
+    po_delete_unordered( po, -1 );
+    po_test_check_index( po );
+
+    /* Duplicates: lowest index is found. */
+    po_push( po, items[ 0 ] );
+    po_insert_at( po, 0, items[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, po_find( po, items[ 0 ] ) );
+    po_delete_at( po, 0 );
+    po_test_check_index( po );
+
+    /* Bulk operations rebuild. */
+    po_push_n( po, &items[ 53 ], 5 );
+    po_delete_range( po, 2, 3 );
+    po_sort( po, po_test_ptr_compare );
+    po_test_check_index( po );
+    po_s dup = po_duplicate( po );
+    po_test_check_index( &dup );
+    po_release( &dup );
+
+    /* Drops delete entries or rebuild. */
+    po_push_n( po, items, 64 );
+    TEST_ASSERT_EQUAL( 1, po_drop( po, 1 ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, items[ 63 ] ) );
+    po_test_check_index( po );
+    po_drop( po, 10 );
+    po_test_check_index( po );
+    po_drop( po, po_used( po ) - 2 );
+    po_test_check_index( po );
+    TEST_ASSERT_EQUAL( 2, po_used( po ) );
+    TEST_ASSERT_EQUAL( 2, po_drop( po, 5 ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, tmp ) );
+    po_push( po, items[ 1 ] );
+    TEST_ASSERT_EQUAL( 0, po_find( po, items[ 1 ] ) );
+
+    po_reset( po );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, items[ 1 ] ) );
+    TEST_ASSERT_TRUE( po_is_indexed( po ) );
+
+    po_index_detach( po );
+    po_push( po, items[ 0 ] );
+    TEST_ASSERT_EQUAL( 0, po_index_find( po, items[ 0 ] ) );
+    po_release( po );
+
+    /* Index with user hash and equal. */
+    char* a = strdup( "alpha" );
+    char* b = strdup( "beta" );
+    po = po_new( &ps );
+    po_push( po, a );
+    po_push( po, b );
+    TEST_ASSERT_TRUE( po_index_attach( po, po_test_str_hash, po_test_str_equal ) );
+    TEST_ASSERT_EQUAL( 1, po_index_find( po, "beta" ) );
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_index_find( po, "gamma" ) );
+    /* po_find() is still identity search. */
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, "beta" ) );
+    po_remove( po );
+    po_remove( po );
+    TEST_ASSERT_TRUE( po_is_indexed( po ) );
+    po_add( po, b );
+    TEST_ASSERT_EQUAL( 0, po_index_find( po, "beta" ) );
+    po_release( po );
+    TEST_ASSERT_EQUAL( NULL, po->ext );
+    free( a );
+    free( b );
+
+    /* Inserts and deletes at both sides of the middle. */
+    po = po_new( &ps );
+    TEST_ASSERT_FALSE( po_is_indexed( po ) );
+    TEST_ASSERT_TRUE( po_index_attach( po, NULL, NULL ) );
+    TEST_ASSERT_TRUE( po_is_indexed( po ) );
+    for ( i = 0; i < 32; i++ ) {
+        po_push( po, items[ i ] );
+    }
+    for ( i = 0; i < 200; i++ ) {
+        po_size_t pos = ( i * 7 ) % ( po_used( po ) + 1 );
+        if ( i % 3 == 2 ) {
+            po_delete_at( po, pos % po_used( po ) );
+        } else {
+            po_insert_at( po, pos, (po_d)( ( 1000 + i ) << 4 ) );
+        }
+        po_test_check_index( po );
+    }
+    po_release( po );
+}
+
+
+#define PO_TEST_CC_THREADS 8
+#define PO_TEST_CC_ITEMS   5000
+
+void* po_test_cc_producer( void* arg )
+{
+    po_cc_t   cc = ( (po_cc_t*)arg )[ 0 ];
+    uintptr_t id = (uintptr_t)( (po_cc_t*)arg )[ 1 ];
+
+    for ( uintptr_t i = 0; i < PO_TEST_CC_ITEMS; i++ ) {
+        po_cc_push( cc, (po_d)( ( ( id * PO_TEST_CC_ITEMS + i + 1 ) << 4 ) | 0x8 ) );
+    }
+
+    return NULL;
+}
+
+
+void test_concurrent( void )
+{
+    po_cc_s   ccs;
+    po_cc_t   cc;
+    pthread_t th[ PO_TEST_CC_THREADS ];
+    po_cc_t   args[ PO_TEST_CC_THREADS ][ 2 ];
+    po_s      ps;
+    po_d*     first;
+
+    cc = po_cc_new( &ccs, 3 );
+    TEST_ASSERT_EQUAL( 4, cc->base );
+    TEST_ASSERT_EQUAL( NULL, po_cc_nth( cc, 0 ) );
+
+    po_cc_push( cc, (po_d)0x8 );
+    first = &cc->seg[ 0 ][ 0 ];
+
+    for ( uintptr_t t = 0; t < PO_TEST_CC_THREADS; t++ ) {
+        args[ t ][ 0 ] = cc;
+        args[ t ][ 1 ] = (po_cc_t)t;
+        pthread_create( &th[ t ], NULL, po_test_cc_producer, args[ t ] );
+    }
+
+    /* Published slot is readable and stable during appends. */
+    for ( int i = 0; i < 1000; i++ ) {
+        TEST_ASSERT_EQUAL( (po_d)0x8, po_cc_nth( cc, 0 ) );
+    }
+
+    for ( int t = 0; t < PO_TEST_CC_THREADS; t++ ) {
+        pthread_join( th[ t ], NULL );
+    }
+
+    TEST_ASSERT_EQUAL( 1 + PO_TEST_CC_THREADS * PO_TEST_CC_ITEMS, po_cc_used( cc ) );
+    TEST_ASSERT_EQUAL( first, &cc->seg[ 0 ][ 0 ] );
+    TEST_ASSERT_EQUAL( (po_d)0x8, *first );
+
+    /* Every item exactly once. */
+    po_new( &ps );
+    TEST_ASSERT_EQUAL( po_cc_used( cc ), po_cc_collect( cc, &ps ) );
+    po_sort( &ps, po_test_ptr_compare );
+    for ( po_size_t i = 0; i < po_used( &ps ); i++ ) {
+        TEST_ASSERT_EQUAL( ( i << 4 ) | 0x8, po_nth( &ps, i ) );
+    }
+    TEST_ASSERT_EQUAL( NULL, po_cc_nth( cc, po_cc_used( cc ) ) );
+
+    po_destroy_storage( &ps );
+    po_cc_destroy_storage( cc );
+
+    cc = po_cc_new( NULL, 0 );
+    po_cc_push( cc, (po_d)0x8 );
+    po_cc_push( cc, (po_d)0x18 );
+    po_cc_push( cc, (po_d)0x28 );
+    TEST_ASSERT_EQUAL( (po_d)0x28, po_cc_nth( cc, 2 ) );
+    po_cc_destroy( cc );
+}
+
+
+void test_deque( void )
+{
+    po_s      ps;
+    po_t      po;
+    uintptr_t next = 1;
+    uintptr_t head = 1;
+
+    po = po_new_sized( &ps, 4 );
+
+    /* FIFO use: usage stays bounded, so does reservation. */
+    for ( int round = 0; round < 1000; round++ ) {
+        po_push( po, (po_d)( next++ ) );
+        po_push( po, (po_d)( next++ ) );
+        TEST_ASSERT_EQUAL( head++, po_pop_front( po ) );
+        if ( po_used( po ) > 5 ) {
+            TEST_ASSERT_EQUAL( head++, po_shift( po ) );
+        }
+        TEST_ASSERT( po_size( po ) >= po_used( po ) );
+    }
+    TEST_ASSERT( po_size( po ) <= 16 );
+
+    for ( po_size_t i = 0; i < po_used( po ); i++ ) {
+        TEST_ASSERT_EQUAL( head + i, po_nth( po, i ) );
+    }
+
+    po_s dup = po_duplicate( po );
+    TEST_ASSERT_EQUAL( head, po_first( &dup ) );
+    TEST_ASSERT_EQUAL( next - 1, po_last( &dup ) );
+    po_destroy_storage( &dup );
+
+    /* Deque use. */
+    while ( po_used( po ) ) {
+        po_pop_front( po );
+    }
+    for ( uintptr_t i = 1; i <= 100; i++ ) {
+        po_push_front( po, (po_d)i );
+        po_unshift( po, (po_d)( 1000 + i ) );
+        po_push( po, (po_d)( 2000 + i ) );
+    }
+    TEST_ASSERT_EQUAL( 300, po_used( po ) );
+    TEST_ASSERT_EQUAL( 1100, po_first( po ) );
+    TEST_ASSERT_EQUAL( 100, po_nth( po, 1 ) );
+    TEST_ASSERT_EQUAL( 2100, po_last( po ) );
+    TEST_ASSERT_EQUAL( 1100, po_pop_front( po ) );
+    TEST_ASSERT_EQUAL( 2100, po_pop( po ) );
+    po_insert_at( po, 1, (po_d)7 );
+    TEST_ASSERT_EQUAL( 7, po_nth( po, 1 ) );
+    po_resize( po, 1024 );
+    TEST_ASSERT_EQUAL( 100, po_first( po ) );
+    TEST_ASSERT_EQUAL( 2099, po_last( po ) );
+    po_destroy_storage( po );
+
+    /* Local Postor moves items in place, without extension. */
+    po_use_local( ls, buf, 8 );
+    po_push( &ls, (po_d)1 );
+    po_push_front( &ls, (po_d)2 );
+    TEST_ASSERT_TRUE( po_get_local( &ls ) );
+    TEST_ASSERT_EQUAL( NULL, ls.ext );
+    TEST_ASSERT_EQUAL( 2, po_pop_front( &ls ) );
+    TEST_ASSERT_EQUAL( 1, po_pop_front( &ls ) );
+    TEST_ASSERT_EQUAL( NULL, po_pop_front( &ls ) );
+    for ( uintptr_t i = 1; i <= 8; i++ ) {
+        po_push( &ls, (po_d)i );
+    }
+    TEST_ASSERT_EQUAL( 1, po_shift( &ls ) );
+    TEST_ASSERT_TRUE( po_get_local( &ls ) );
+    TEST_ASSERT_EQUAL( 8, po_size( &ls ) );
+    TEST_ASSERT_EQUAL( NULL, ls.ext );
+    po_destroy_storage( &ls );
+
+    /* Pop from full Postor does not grow it. */
+    po = po_new_sized( &ps, 1024 );
+    po_set_growth( po, PO_GROW_DOUBLE, 0 );
+    for ( uintptr_t i = 1; i <= 1024; i++ ) {
+        po_push( po, (po_d)i );
+    }
+    TEST_ASSERT_EQUAL( 1, po_shift( po ) );
+    TEST_ASSERT_EQUAL( 1024, po_size( po ) );
+    TEST_ASSERT_EQUAL( 2, po_shift( po ) );
+    TEST_ASSERT( po_size( po ) <= 1024 );
+    TEST_ASSERT_EQUAL( 3, po_first( po ) );
+    po_destroy_storage( po );
+
+    /* Inline Postor stays inline. */
+    po = po_new_packed( 8 );
+    for ( uintptr_t i = 1; i <= 8; i++ ) {
+        po_push( po, (po_d)i );
+    }
+    TEST_ASSERT_EQUAL( 1, po_shift( po ) );
+    po_unshift( po, (po_d)9 );
+    TEST_ASSERT_TRUE( po_get_local( po ) );
+    TEST_ASSERT_EQUAL( 8, po_size( po ) );
+    TEST_ASSERT_EQUAL( 9, po_first( po ) );
+    po_destroy( po );
+
+    /* Size is not below usage with full allocation after headroom. */
+    po = po_new_sized( &ps, 8 );
+    for ( uintptr_t i = 1; i <= 8; i++ ) {
+        po_push( po, (po_d)i );
+    }
+    for ( uintptr_t i = 1; i <= 8; i++ ) {
+        TEST_ASSERT_EQUAL( i, po_pop_front( po ) );
+        TEST_ASSERT( po_size( po ) >= po_used( po ) );
+        po_push( po, (po_d)( 8 + i ) );
+        TEST_ASSERT( po_size( po ) >= po_used( po ) );
+    }
+    for ( uintptr_t i = 1; i <= 8; i++ ) {
+        po_push_front( po, (po_d)( 100 + i ) );
+        TEST_ASSERT( po_size( po ) >= po_used( po ) );
+    }
+    TEST_ASSERT_EQUAL( 108, po_first( po ) );
+    TEST_ASSERT_EQUAL( 16, po_last( po ) );
+    po_destroy_storage( po );
+
+    /* Index follows front operations. */
+    po = po_new( &ps );
+    po_index_attach( po, NULL, NULL );
+    for ( uintptr_t i = 1; i <= 100; i++ ) {
+        po_push_front( po, (po_d)i );
+        po_push( po, (po_d)( 1000 + i ) );
+    }
+    TEST_ASSERT_EQUAL( 0, po_find( po, (po_d)100 ) );
+    TEST_ASSERT_EQUAL( 99, po_find( po, (po_d)1 ) );
+    TEST_ASSERT_EQUAL( 199, po_find( po, (po_d)1100 ) );
+    for ( uintptr_t i = 100; i > 50; i-- ) {
+        TEST_ASSERT_EQUAL( i, po_pop_front( po ) );
+    }
+    TEST_ASSERT_EQUAL( PO_NOT_INDEX, po_find( po, (po_d)51 ) );
+    TEST_ASSERT_EQUAL( 0, po_find( po, (po_d)50 ) );
+    TEST_ASSERT_EQUAL( 49, po_find( po, (po_d)1 ) );
+    TEST_ASSERT_EQUAL( 50, po_find( po, (po_d)1001 ) );
+    po_insert_at( po, 10, (po_d)7777 );
+    TEST_ASSERT_EQUAL( 10, po_find( po, (po_d)7777 ) );
+    TEST_ASSERT_EQUAL( 51, po_find( po, (po_d)1001 ) );
+    po_release( po );
+}
+
+
+#define PO_TEST_SPSC_ITEMS 100000
+
+void* po_test_spsc_producer( void* arg )
+{
+    po_spsc_t sp = arg;
+
+    for ( uintptr_t i = 1; i <= PO_TEST_SPSC_ITEMS; i++ ) {
+        while ( !po_spsc_push( sp, (po_d)i ) ) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+
+void test_spsc( void )
+{
+    po_spsc_s sps;
+    po_spsc_t sp;
+    pthread_t th;
+    uintptr_t expect = 1;
+
+    sp = po_spsc_new( &sps, 5 );
+    TEST_ASSERT_EQUAL( 7, sp->mask );
+    TEST_ASSERT_EQUAL( NULL, po_spsc_pop( sp ) );
+
+    for ( uintptr_t i = 1; i <= 8; i++ ) {
+        TEST_ASSERT_TRUE( po_spsc_push( sp, (po_d)i ) );
+    }
+    TEST_ASSERT_FALSE( po_spsc_push( sp, (po_d)9 ) );
+    TEST_ASSERT_EQUAL( 8, po_spsc_used( sp ) );
+    TEST_ASSERT_EQUAL( 1, po_spsc_pop( sp ) );
+    TEST_ASSERT_TRUE( po_spsc_push( sp, (po_d)9 ) );
+    for ( uintptr_t i = 2; i <= 9; i++ ) {
+        TEST_ASSERT_EQUAL( i, po_spsc_pop( sp ) );
+    }
+    TEST_ASSERT_EQUAL( 0, po_spsc_used( sp ) );
+    po_spsc_destroy_storage( sp );
+
+    /* Producer and consumer threads. */
+    sp = po_spsc_new( NULL, 64 );
+    pthread_create( &th, NULL, po_test_spsc_producer, sp );
+    while ( expect <= PO_TEST_SPSC_ITEMS ) {
+        po_d item = po_spsc_pop( sp );
+        if ( item ) {
+            TEST_ASSERT_EQUAL( expect, item );
+            expect++;
+        } else {
+            sched_yield();
+        }
+    }
+    pthread_join( th, NULL );
+    TEST_ASSERT_EQUAL( NULL, po_spsc_pop( sp ) );
+    po_spsc_destroy( sp );
+}
+
+
+void* po_test_pool_worker( void* arg )
+{
+    po_t      keep = arg;
+    po_s      ps;
+    po_size_t n;
+
+    for ( po_size_t r = 0; r < 2000; r++ ) {
+        n = ( r * 7 ) % 300;
+        po_new_sized( &ps, r % 40 );
+        for ( po_size_t i = 0; i < n; i++ ) {
+            po_push( &ps, (po_d)( i + 1 ) );
+        }
+        for ( po_size_t i = 0; i < n; i++ ) {
+            TEST_ASSERT_TRUE( po_nth( &ps, i ) == (po_d)( i + 1 ) );
+        }
+        po_destroy_storage( &ps );
+    }
+
+    /* Freed by another thread. */
+    po_new_sized( keep, 100 );
+    po_push( keep, (po_d)1 );
+
+    return NULL;
+}
+
+
+void test_pool( void )
+{
+    pthread_t th[ 4 ];
+    po_s      keep[ 4 ];
+    po_s      ps;
+    po_t      po;
+
+
+    for ( int t = 0; t < 4; t++ ) {
+        pthread_create( &th[ t ], NULL, po_test_pool_worker, &keep[ t ] );
+    }
+    for ( int t = 0; t < 4; t++ ) {
+        pthread_join( th[ t ], NULL );
+        TEST_ASSERT_TRUE( po_first( &keep[ t ] ) == (po_d)1 );
+        po_destroy_storage( &keep[ t ] );
+    }
+
+    /* Recycled blocks are cleared. */
+    po = po_new_sized( &ps, 64 );
+    for ( po_size_t i = 0; i < 64; i++ ) {
+        po_push( po, (po_d)1 );
+    }
+    po_destroy_storage( po );
+    po = po_new_sized( &ps, 64 );
+#ifndef POSTOR_NO_CLEAR
+    TEST_ASSERT_TRUE( po_data( po )[ 63 ] == NULL );
+#endif
+    po_destroy_storage( po );
+
+    /* Paged storage can be returned to pool. */
+    po = po_new_pages( &ps, 1 );
+    po_destroy_storage( po );
+
+    po_pool_trim();
+}
+
+
+void test_descriptor( void )
+{
+    po_t po;
+    po_t pos[ 200 ];
+
+
+    for ( int r = 0; r < 2; r++ ) {
+        for ( int i = 0; i < 200; i++ ) {
+            pos[ i ] = po_new( NULL );
+            po_push( pos[ i ], (po_d)pos[ i ] );
+        }
+        for ( int i = 0; i < 200; i++ ) {
+            TEST_ASSERT_TRUE( po_first( pos[ i ] ) == (po_d)pos[ i ] );
+            po_destroy( pos[ i ] );
+        }
+    }
+
+    /* Packed descriptor and data. */
+    po = po_new_packed( 4 );
+    TEST_ASSERT_TRUE( po_data( po ) == (po_d*)( po + 1 ) );
+    TEST_ASSERT_TRUE( po_get_local( po ) );
+    for ( po_size_t i = 0; i < 4; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    TEST_ASSERT_TRUE( po_data( po ) == (po_d*)( po + 1 ) );
+    po_push( po, (po_d)5 );
+    TEST_ASSERT_FALSE( po_get_local( po ) );
+    for ( po_size_t i = 0; i < 5; i++ ) {
+        TEST_ASSERT_TRUE( po_nth( po, i ) == (po_d)( i + 1 ) );
+    }
+    po_destroy( po );
+
+    po = po_new_packed( 0 );
+    TEST_ASSERT_TRUE( po_size( po ) == PO_MIN_SIZE );
+    po_destroy( po );
+
+    /* Many slabs. */
+    po = po_new( NULL );
+    for ( po_size_t i = 0; i < 5000; i++ ) {
+        po_push( po, (po_d)po_new( NULL ) );
+    }
+    for ( po_size_t i = 0; i < 5000; i++ ) {
+        po_destroy( (po_t)po_nth( po, i ) );
+    }
+    po_destroy( po );
+
+    /* User allocated descriptor. */
+    po = po_new( po_malloc( sizeof( po_s ) ) );
+    po_push( po, (po_d)1 );
+    TEST_ASSERT_TRUE( po_first( po ) == (po_d)1 );
+    po_destroy( po );
+}
+
+
+void test_stats( void )
+{
+    po_s       ps;
+    po_t       po;
+    po_stats_s st;
+
+
+    po_stats_reset();
+
+    po = po_new_sized( &ps, 16 );
+    for ( po_size_t i = 0; i < 17; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    po_insert_at( po, 0, (po_d)100 );
+    po_delete_at( po, 0 );
+    po_find( po, (po_d)5 );
+    po_find_with( po, po_compare_fn, (po_d)1000 );
+    po_stats_get( &st );
+
+#ifdef POSTOR_USE_STATS
+    TEST_ASSERT_TRUE( st.resizes == 1 );
+    TEST_ASSERT_TRUE( st.resize_bytes == 32 * sizeof( po_d ) );
+#    ifndef POSTOR_NO_CLEAR
+    TEST_ASSERT_TRUE( st.clear_bytes >= 16 * sizeof( po_d ) );
+#    else
+    TEST_ASSERT_TRUE( st.clear_bytes == 0 );
+#    endif
+    TEST_ASSERT_TRUE( st.move_bytes == 2 * 17 * sizeof( po_d ) );
+    TEST_ASSERT_TRUE( st.compares == 5 + 17 );
+    TEST_ASSERT_TRUE( st.peak_used >= 18 );
+    TEST_ASSERT_TRUE( st.peak_size >= 32 );
+
+    po_stats_reset();
+    po_stats_get( &st );
+    TEST_ASSERT_TRUE( st.resizes == 0 && st.peak_used == 0 );
+#else
+    TEST_ASSERT_TRUE( st.resizes == 0 && st.compares == 0 );
+#endif
+
+    po_destroy_storage( po );
+}
+
+
+void test_segmented( void )
+{
+    po_seg_s  sgs;
+    po_seg_t  sg;
+    po_d*     ref0;
+    po_d*     ref1;
+    po_d*     chunk;
+    po_size_t n;
+    po_size_t k;
+    po_size_t sum;
+
+
+    sg = po_seg_new( &sgs, 100 );
+    TEST_ASSERT_TRUE( sg->shift == 7 );
+    TEST_ASSERT_TRUE( po_seg_nth_ref( sg, 0 ) == NULL );
+    TEST_ASSERT_TRUE( po_seg_pop( sg ) == NULL );
+
+    po_seg_push( sg, (po_d)1 );
+    ref0 = po_seg_nth_ref( sg, 0 );
+    for ( po_size_t i = 1; i < 1000; i++ ) {
+        po_seg_push( sg, (po_d)( i + 1 ) );
+    }
+    ref1 = po_seg_nth_ref( sg, 500 );
+
+    /* References are stable over growth. */
+    for ( po_size_t i = 1000; i < 10000; i++ ) {
+        po_seg_push( sg, (po_d)( i + 1 ) );
+    }
+    TEST_ASSERT_TRUE( ref0 == po_seg_nth_ref( sg, 0 ) );
+    TEST_ASSERT_TRUE( ref1 == po_seg_nth_ref( sg, 500 ) );
+    TEST_ASSERT_TRUE( *ref1 == (po_d)501 );
+    TEST_ASSERT_TRUE( po_seg_used( sg ) == 10000 );
+    TEST_ASSERT_TRUE( po_seg_nth( sg, 9999 ) == (po_d)10000 );
+    TEST_ASSERT_TRUE( po_seg_nth( sg, 10000 ) == NULL );
+
+    /* Chunk iteration. */
+    sum = 0;
+    for ( k = 0; ( chunk = po_seg_chunk( sg, k, &n ) ); k++ ) {
+        for ( po_size_t i = 0; i < n; i++ ) {
+            sum += (uintptr_t)chunk[ i ];
+        }
+    }
+    TEST_ASSERT_TRUE( k == 79 );
+    TEST_ASSERT_TRUE( sum == 10000ULL * 10001 / 2 );
+
+    TEST_ASSERT_TRUE( po_seg_pop( sg ) == (po_d)10000 );
+    TEST_ASSERT_TRUE( po_seg_used( sg ) == 9999 );
+    po_seg_reset( sg );
+    TEST_ASSERT_TRUE( po_seg_used( sg ) == 0 );
+    po_seg_push( sg, (po_d)7 );
+    TEST_ASSERT_TRUE( ref0 == po_seg_nth_ref( sg, 0 ) );
+    po_seg_destroy_storage( sg );
+
+    sg = po_seg_new( NULL, 0 );
+    TEST_ASSERT_TRUE( ( 1ULL << sg->shift ) == PO_SEG_CHUNK );
+    po_seg_push( sg, (po_d)1 );
+    sg = po_seg_destroy( sg );
+    TEST_ASSERT_TRUE( sg == NULL );
+}
+
+
+void test_compressed( void )
+{
+    po_s    pos;
+    po_t    po;
+    po_cp_s cps;
+    po_cp_t cp;
+    char*   mem[ 100 ];
+
+
+    po = po_new_pages( &pos, 4 );
+    for ( int i = 0; i < 100; i++ ) {
+        mem[ i ] = po_alloc_bytes( po, 64 );
+    }
+
+    cp = po_cp_new( &cps, po_data( po ), 3 );
+    TEST_ASSERT_TRUE( po_cp_pop( cp ) == NULL );
+    for ( int i = 0; i < 100; i++ ) {
+        TEST_ASSERT_TRUE( po_cp_push( cp, mem[ i ] ) );
+    }
+    TEST_ASSERT_TRUE( po_cp_push( cp, NULL ) );
+    TEST_ASSERT_TRUE( po_cp_used( cp ) == 101 );
+    TEST_ASSERT_TRUE( cp->size * sizeof( uint32_t ) < 101 * sizeof( po_d ) );
+
+    TEST_ASSERT_TRUE( po_cp_nth( cp, 0 ) == mem[ 0 ] );
+    TEST_ASSERT_TRUE( po_cp_nth( cp, 99 ) == mem[ 99 ] );
+    TEST_ASSERT_TRUE( po_cp_nth( cp, 100 ) == NULL );
+    TEST_ASSERT_TRUE( po_cp_nth( cp, 101 ) == NULL );
+    TEST_ASSERT_TRUE( po_cp_find( cp, mem[ 42 ] ) == 42 );
+    TEST_ASSERT_TRUE( po_cp_find( cp, NULL ) == 100 );
+    TEST_ASSERT_TRUE( po_cp_find( cp, mem[ 42 ] + 64 * 200 ) == PO_NOT_INDEX );
+
+    /* Misaligned and below base. */
+    TEST_ASSERT_FALSE( po_cp_fits( cp, mem[ 1 ] + 1 ) );
+    TEST_ASSERT_FALSE( po_cp_push( cp, mem[ 1 ] + 1 ) );
+    TEST_ASSERT_FALSE( po_cp_fits( cp, mem[ 0 ] - 8 ) );
+    TEST_ASSERT_TRUE( po_cp_find( cp, mem[ 0 ] - 8 ) == PO_NOT_INDEX );
+    TEST_ASSERT_TRUE( po_cp_used( cp ) == 101 );
+
+    /* Range limit. */
+    TEST_ASSERT_TRUE( po_cp_fits( cp, cp->base + ( ( UINT32_MAX - 1ULL ) << 3 ) ) );
+    TEST_ASSERT_FALSE( po_cp_fits( cp, cp->base + ( (po_size_t)UINT32_MAX << 3 ) ) );
+
+    TEST_ASSERT_TRUE( po_cp_pop( cp ) == NULL );
+    TEST_ASSERT_TRUE( po_cp_pop( cp ) == mem[ 99 ] );
+    po_cp_reset( cp );
+    TEST_ASSERT_TRUE( po_cp_used( cp ) == 0 );
+    po_cp_destroy_storage( cp );
+
+    cp = po_cp_new( NULL, po_data( po ), 0 );
+    TEST_ASSERT_TRUE( po_cp_push( cp, mem[ 1 ] + 1 ) );
+    TEST_ASSERT_TRUE( po_cp_nth( cp, 0 ) == mem[ 1 ] + 1 );
+    cp = po_cp_destroy( cp );
+    TEST_ASSERT_TRUE( cp == NULL );
+
+    po_destroy_storage( po );
+}
+
+
+typedef struct
+{
+    uint64_t key;
+    double   value;
+    uint32_t flags;
+} rec_test_s;
+
+
+void test_record( void )
+{
+    po_s       pos;
+    po_t       po;
+    po_d       buf[ 8 ];
+    po_rec_s   rcs;
+    po_rec_t   rc;
+    rec_test_s rec;
+    uint64_t*  col;
+    po_size_t  stride;
+    uint64_t   sum;
+
+
+    for ( int soa = 0; soa < 2; soa++ ) {
+
+        /* Local buffer spills to heap on growth. */
+        po = po_use( &pos, buf, 8 );
+        rc = po_rec_new( &rcs, po, sizeof( rec_test_s ), soa );
+        TEST_ASSERT_TRUE( rc->width == 3 );
+        TEST_ASSERT_TRUE( po_rec_column( rc, 3, &stride ) == NULL );
+
+        for ( uint64_t i = 0; i < 1000; i++ ) {
+            rec.key = i;
+            rec.value = i * 0.5;
+            rec.flags = (uint32_t)i | 0x10000;
+            TEST_ASSERT_TRUE( po_rec_push( rc, &rec ) == i );
+        }
+        TEST_ASSERT_FALSE( po_get_local( po ) );
+        TEST_ASSERT_TRUE( po_rec_used( rc ) == 1000 );
+        TEST_ASSERT_TRUE( po_used( po ) == 3000 );
+
+        for ( uint64_t i = 0; i < 1000; i++ ) {
+            TEST_ASSERT_TRUE( po_rec_get( rc, i, &rec ) );
+            TEST_ASSERT_TRUE( rec.key == i );
+            TEST_ASSERT_TRUE( rec.value == i * 0.5 );
+            TEST_ASSERT_TRUE( rec.flags == ( (uint32_t)i | 0x10000 ) );
+        }
+        TEST_ASSERT_FALSE( po_rec_get( rc, 1000, &rec ) );
+
+        col = po_rec_column( rc, 0, &stride );
+        TEST_ASSERT_TRUE( stride == ( soa ? 1 : 3 ) );
+        sum = 0;
+        for ( po_size_t i = 0; i < po_rec_used( rc ); i++ ) {
+            sum += col[ i * stride ];
+        }
+        TEST_ASSERT_TRUE( sum == 999 * 1000 / 2 );
+
+        if ( soa ) {
+            TEST_ASSERT_TRUE( po_rec_nth( rc, 0 ) == NULL );
+        } else {
+            TEST_ASSERT_TRUE( ( (rec_test_s*)po_rec_nth( rc, 10 ) )->key == 10 );
+        }
+        TEST_ASSERT_TRUE( po_rec_nth( rc, 1000 ) == NULL );
+
+        *po_rec_field( rc, 5, 0 ) = 55;
+        po_rec_get( rc, 5, &rec );
+        TEST_ASSERT_TRUE( rec.key == 55 );
+        TEST_ASSERT_TRUE( po_rec_field( rc, 1000, 0 ) == NULL );
+        rec.key = 66;
+        TEST_ASSERT_TRUE( po_rec_set( rc, 6, &rec ) );
+        TEST_ASSERT_TRUE( *po_rec_field( rc, 6, 0 ) == 66 );
+        TEST_ASSERT_FALSE( po_rec_set( rc, 1000, &rec ) );
+
+        TEST_ASSERT_TRUE( po_rec_push( rc, NULL ) == 1000 );
+        TEST_ASSERT_TRUE( *po_rec_field( rc, 1000, 2 ) == 0 );
+        TEST_ASSERT_TRUE( po_rec_pop( rc, NULL ) );
+        TEST_ASSERT_TRUE( po_rec_pop( rc, &rec ) );
+        TEST_ASSERT_TRUE( rec.key == 999 );
+        TEST_ASSERT_TRUE( po_rec_used( rc ) == 999 );
+
+        po_rec_reset( rc );
+        TEST_ASSERT_TRUE( po_rec_used( rc ) == 0 );
+        TEST_ASSERT_FALSE( po_rec_pop( rc, &rec ) );
+        po_destroy_storage( po );
+    }
+
+    /* Padding of last field is cleared over stale data. */
+    for ( int soa = 0; soa < 2; soa++ ) {
+        po = po_new( &pos );
+        rc = po_rec_new( &rcs, po, 4, soa );
+        po_rec_push( rc, NULL );
+        *po_rec_field( rc, 0, 0 ) = ~0ULL;
+        po_rec_pop( rc, NULL );
+        po_rec_push( rc, &( uint32_t ){ 7 } );
+        TEST_ASSERT_TRUE( *po_rec_field( rc, 0, 0 ) == 7 );
+        *po_rec_field( rc, 0, 0 ) = ~0ULL;
+        po_rec_set( rc, 0, &( uint32_t ){ 8 } );
+        TEST_ASSERT_TRUE( *po_rec_field( rc, 0, 0 ) == 8 );
+        po_destroy_storage( po );
+    }
+
+    po = po_new( NULL );
+    rc = po_rec_new( NULL, po, 4, 1 );
+    TEST_ASSERT_TRUE( rc->width == 1 );
+    po_rec_push( rc, &( uint32_t ){ 7 } );
+    TEST_ASSERT_TRUE( *po_rec_field( rc, 0, 0 ) == 7 );
+    rc = po_rec_destroy( rc );
+    TEST_ASSERT_TRUE( rc == NULL );
+    po_destroy( po );
+}
+
+
+static void visit_sum( po_d item, po_d state )
+{
+    if ( item ) {
+        *(po_size_t*)state += *(po_size_t*)item;
+    } else {
+        *(po_size_t*)state += 1000000;
+    }
+}
+
+
+void test_visit( void )
+{
+    po_s      pos;
+    po_t      po;
+    po_size_t vals[ 103 ];
+    po_size_t sum;
+
+
+    po = po_new( &pos );
+
+    sum = 0;
+    po_visit( po, visit_sum, &sum );
+    TEST_ASSERT_TRUE( sum == 0 );
+
+    for ( po_size_t i = 0; i < 103; i++ ) {
+        vals[ i ] = i;
+        po_push( po, &vals[ i ] );
+    }
+
+    sum = 0;
+    po_visit( po, visit_sum, &sum );
+    TEST_ASSERT_TRUE( sum == 102 * 103 / 2 );
+
+    /* NULL items are visited. */
+    po_assign( po, 1, NULL );
+    po_assign( po, 50, NULL );
+    sum = 0;
+    po_visit( po, visit_sum, &sum );
+    TEST_ASSERT_TRUE( sum == 102 * 103 / 2 - 51 + 2000000 );
+
+    sum = 0;
+    po_visit_range( po, 10, 13, visit_sum, &sum );
+    TEST_ASSERT_TRUE( sum == 10 + 11 + 12 );
+
+    sum = 0;
+    po_visit_range( po, 100, 1000, visit_sum, &sum );
+    TEST_ASSERT_TRUE( sum == 100 + 101 + 102 );
+
+    sum = 0;
+    po_visit_range( po, 20, 10, visit_sum, &sum );
+    po_visit_range( po, 200, 300, visit_sum, &sum );
+    po_visit_range( po, (po_size_t)-2, 10, visit_sum, &sum );
+    TEST_ASSERT_TRUE( sum == 0 );
+
+    po_destroy_storage( po );
+}
+
+
+void test_shared( void )
+{
+    po_s pos;
+    po_t po;
+    po_s dup;
+    po_s dup2;
+    po_s loc;
+    po_d buf[ 8 ];
+
+
+    po = po_new( &pos );
+    for ( po_size_t i = 0; i < 100; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+
+    /* Read-only duplicate shares storage. */
+    dup = po_duplicate_shared( po );
+    TEST_ASSERT_TRUE( po_is_shared( po ) );
+    TEST_ASSERT_TRUE( po_is_shared( &dup ) );
+    TEST_ASSERT_TRUE( po_data( &dup ) == po_data( po ) );
+    TEST_ASSERT_TRUE( po_used( &dup ) == 100 );
+    TEST_ASSERT_TRUE( po_nth( &dup, 99 ) == (po_d)100 );
+    TEST_ASSERT_TRUE( po_find( &dup, (po_d)50 ) == 49 );
+
+    /* First mutation copies. */
+    po_push( &dup, (po_d)101 );
+    TEST_ASSERT_FALSE( po_is_shared( &dup ) );
+    TEST_ASSERT_TRUE( po_data( &dup ) != po_data( po ) );
+    TEST_ASSERT_TRUE( po_used( po ) == 100 );
+    TEST_ASSERT_TRUE( po_used( &dup ) == 101 );
+
+    /* Last holder owns storage without copy. */
+    TEST_ASSERT_TRUE( po_is_shared( po ) );
+    po_d* data = po_data( po );
+    po_swap( po, 0, (po_d)1000 );
+    TEST_ASSERT_FALSE( po_is_shared( po ) );
+    TEST_ASSERT_TRUE( po_data( po ) == data );
+    TEST_ASSERT_TRUE( po_nth( &dup, 0 ) == (po_d)1 );
+    po_destroy_storage( &dup );
+
+    /* Multiple holders, destroyed in any order. */
+    dup = po_duplicate_shared( po );
+    dup2 = po_duplicate_shared( &dup );
+    TEST_ASSERT_TRUE( po_data( &dup2 ) == po_data( po ) );
+    po_destroy_storage( po );
+    po_delete_at( &dup, 0 );
+    TEST_ASSERT_TRUE( po_first( &dup ) == (po_d)2 );
+    TEST_ASSERT_TRUE( po_first( &dup2 ) == (po_d)1000 );
+    po_sort( &dup2, po_test_ptr_compare );
+    TEST_ASSERT_FALSE( po_is_shared( &dup2 ) );
+    TEST_ASSERT_TRUE( po_last( &dup2 ) == (po_d)1000 );
+    po_destroy_storage( &dup );
+    po_destroy_storage( &dup2 );
+
+    /* Explicit unshare before raw writes. */
+    po = po_new( &pos );
+    po_push( po, (po_d)1 );
+    dup = po_duplicate_shared( po );
+    po_unshare( &dup );
+    po_assign( &dup, 0, (po_d)2 );
+    TEST_ASSERT_TRUE( po_first( po ) == (po_d)1 );
+    dup2 = po_duplicate( po );
+    TEST_ASSERT_FALSE( po_is_shared( &dup2 ) );
+    po_destroy_storage( &dup2 );
+    po_destroy_storage( &dup );
+    po_destroy_storage( po );
+
+    /* Local storage is copied. */
+    po_use( &loc, buf, 8 );
+    po_push( &loc, (po_d)1 );
+    dup = po_duplicate_shared( &loc );
+    TEST_ASSERT_FALSE( po_is_shared( &dup ) );
+    TEST_ASSERT_TRUE( po_data( &dup ) != buf );
+    po_destroy_storage( &dup );
+}
@@ -0,0 +1,82 @@
+#include "unity.h"
+#include "postor.h"
+#include <string.h>
+
+/*
+ * Tests for POSTOR_NO_CLEAR build (see project.yml).
+ */
+
+
+void test_noclear_storage( void )
+{
+    po_s ps;
+    po_t po;
+
+
+    po = po_new( &ps );
+    for ( po_size_t i = 0; i < 1000; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    TEST_ASSERT_TRUE( po_used( po ) == 1000 );
+    TEST_ASSERT_TRUE( po_nth( po, 999 ) == (po_d)1000 );
+
+    po_shrink_to_fit( po );
+    TEST_ASSERT_TRUE( po_nth( po, 0 ) == (po_d)1 );
+    po_destroy_storage( po );
+}
+
+
+void test_noclear_empty( void )
+{
+    po_s ps;
+    po_t po;
+    po_d buf[ 8 ];
+
+
+    /* Storage is not cleared, but empty Postor has no items. */
+    memset( buf, 0xAB, sizeof( buf ) );
+    po = po_use( &ps, buf, 8 );
+    TEST_ASSERT_TRUE( buf[ 0 ] != NULL );
+    TEST_ASSERT_TRUE( po_first( po ) == NULL );
+    TEST_ASSERT_TRUE( po_last( po ) == NULL );
+    TEST_ASSERT_TRUE( po_nth( po, 0 ) == NULL );
+    TEST_ASSERT_TRUE( po_pop( po ) == NULL );
+
+    po_push( po, (po_d)1 );
+    TEST_ASSERT_TRUE( po_first( po ) == (po_d)1 );
+    TEST_ASSERT_TRUE( po_pop( po ) == (po_d)1 );
+    TEST_ASSERT_TRUE( po_first( po ) == NULL );
+
+    po = po_new( &ps );
+    TEST_ASSERT_TRUE( po_first( po ) == NULL );
+    po_destroy_storage( po );
+}
+
+
+void test_noclear_explicit( void )
+{
+    po_s ps;
+    po_t po;
+    po_d mem;
+
+
+    /* Explicit clearing is still done. */
+    po = po_new( &ps );
+    for ( po_size_t i = 0; i < 10; i++ ) {
+        po_push( po, (po_d)( i + 1 ) );
+    }
+    po_clear_used( po );
+    for ( po_size_t i = 0; i < 10; i++ ) {
+        TEST_ASSERT_TRUE( po_data( po )[ i ] == NULL );
+    }
+    po_destroy_storage( po );
+
+    /* Arena allocations work without clearing. */
+    po = po_new_arena( &ps, 1 );
+    mem = po_alloc_bytes( po, 64 );
+    TEST_ASSERT_TRUE( mem != NULL );
+    memset( mem, 0xCD, 64 );
+    po_arena_release( po );
+    TEST_ASSERT_TRUE( po_alloc_bytes( po, 64 ) == mem );
+    po_destroy_storage( po );
+}